@@ -0,0 +1,155 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Looks up many words in the same corpus at once
+*/
+
+#ifndef BATCHMATCHER_HPP_INCLUDED
+#define BATCHMATCHER_HPP_INCLUDED
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "levautomaton.hpp"
+
+/**
+  @brief BatchMatcher finds the words within Levenshtein distance k for a whole list of queries,
+         e.g. all words of a document
+         Identical queries are looked up only once, and the corpus is shared by all lookups
+*/
+class BatchMatcher
+  {
+   private: // Types
+      typedef std::string                       Word;
+      typedef std::vector<Word>                 WordVec;
+      typedef LevenshteinAutomaton::Mode        Mode;
+
+
+   public: // Functions
+    /**
+      @brief Constructor from a shared corpus and maximum edit distance
+      @param words, the shared corpus
+      @param distance, the maximum edit distance k
+      @param mode, how the automata are built
+      @param costs, the cost of every edit operation
+      @param cache, the cache of compiled automata shared with other lookups, if any
+    */
+    BatchMatcher(const CorpusPtr& words, const unsigned& distance,
+                 const Mode& mode = LevenshteinAutomaton::PARAMETRIC, const EditCosts& costs = EditCosts::levenshtein(),
+                 const DFACachePtr& cache = nullptr)
+    {
+        corpus = words;
+        k = distance;
+        this->mode = mode;
+        this->costs = costs;
+        this->cache = cache;
+    }
+
+    /**
+      @brief Returns the matches of every query
+      @param queries, the lookup words, may contain repetitions
+      @return For every query the sorted vector of words within distance k, in the order of the queries
+    */
+    std::vector<WordVec> match(const WordVec& queries) const
+    {
+        WordVec words;
+        std::vector<std::size_t> slots;
+        distinct(queries, words, slots);
+
+        // Each distinct query walks the corpus on its own: a shared walk of all automata
+        // visits fewer nodes, but switching between the automata at every node costs more
+        // than that saves unless the queries share long prefixes
+        std::vector<WordVec> found(words.size());
+        for (std::size_t i = 0; i < words.size(); i++) {
+            LevenshteinAutomaton lev(words[i], k, corpus, mode, costs, cache);
+            found[i] = lev.get_all_matches();
+        }
+
+        return spread(found, slots);
+
+    } // match
+
+    /**
+      @brief Returns the matches of every query, using all threads of a pool
+             With at least as many distinct queries as threads, the queries are spread over the threads,
+             otherwise every query searches parts of the corpus index in parallel
+      @param queries, the lookup words, may contain repetitions
+      @param pool, the threads to use
+      @return For every query the sorted vector of words within distance k, in the order of the queries
+    */
+    std::vector<WordVec> match(const WordVec& queries, WorkStealingPool& pool) const
+    {
+        WordVec words;
+        std::vector<std::size_t> slots;
+        distinct(queries, words, slots);
+
+        std::vector<WordVec> found(words.size());
+        if (words.size() >= pool.size()) {
+            pool.parallel_for(words.size(), [&](std::size_t i) {
+                LevenshteinAutomaton lev(words[i], k, corpus, mode, costs, cache);
+                found[i] = lev.get_all_matches();
+            });
+        }
+        else {
+            for (std::size_t i = 0; i < words.size(); i++) {
+                LevenshteinAutomaton lev(words[i], k, corpus, mode, costs, cache);
+                found[i] = lev.get_all_matches(pool);
+            }
+        }
+
+        return spread(found, slots);
+
+    } // match
+
+
+   private: // Functions
+    /**
+      @brief Removes repetitions from the queries, identical queries share one automaton and one result
+      @param queries, the lookup words
+      @param words, receives the distinct lookup words
+      @param slots, receives for every query the position of its word in words
+    */
+    static void distinct(const WordVec& queries, WordVec& words, std::vector<std::size_t>& slots)
+    {
+        std::map<Word, std::size_t> seen;
+        for (auto& q: queries) {
+            auto pos = seen.insert(std::make_pair(q, words.size()));
+            if (pos.second == true) { words.push_back(q); }
+            slots.push_back(pos.first->second);
+        }
+
+    } // distinct
+
+    /**
+      @brief Hands the results of the distinct words back to every query
+      @param found, the matches of every distinct word
+      @param slots, for every query the position of its word
+      @return For every query its matches
+    */
+    static std::vector<WordVec> spread(const std::vector<WordVec>& found, const std::vector<std::size_t>& slots)
+    {
+        std::vector<WordVec> matches(slots.size());
+        for (std::size_t q = 0; q < slots.size(); q++) {
+            matches[q] = found[slots[q]];
+        }
+
+        return matches;
+
+    } // spread
+
+
+   private: // variables
+      CorpusPtr             corpus;     ///< the list of all possible words
+      unsigned              k;          ///< the max. allowed Lev-distance
+      Mode                  mode;       ///< how the automata are built
+      EditCosts             costs;      ///< what every edit operation adds to the distance
+      DFACachePtr           cache;      ///< the cache of compiled automata, if any
+
+  }; // BatchMatcher
+
+#endif // BATCHMATCHER_HPP_INCLUDED
@@ -0,0 +1,276 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Bit-parallel edit distance (Myers, in the formulation of Hyyroe)
+Presented with the same interface as the deterministic automata
+*/
+
+#ifndef BITPARALLEL_HPP_INCLUDED
+#define BITPARALLEL_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+/**
+  @brief BitParallelAutomaton computes the edit distance between a lookup word of at most 64 bytes
+         and an input, one column of the dynamic programming matrix per input byte
+         A column is kept as two bit vectors of vertical +1 / -1 steps and the value of its last cell,
+         so a step costs a handful of word operations whatever the length of the lookup word
+         The last cell within k is tracked as well (Ukkonen's cut-off), which tells in constant time
+         on average whether any continuation can still come within k
+         Nothing has to be constructed per lookup word besides a table of 256 match masks
+*/
+class BitParallelAutomaton
+  {
+   public: // Types
+      /// A column of the matrix: the positive and negative vertical steps, the distance of the whole word
+      /// and the lowest cell within k with its value
+      struct State
+      {
+          std::uint64_t     vp;
+          std::uint64_t     vn;
+          unsigned          score;
+          unsigned          row;
+          unsigned          cell;
+      };
+
+      enum { MAX_LENGTH = 64 };                 ///< the longest lookup word that fits into the bit vectors
+
+   private: // Types
+      typedef std::string                       Word;
+
+      enum { DEAD = 0xFFFFFFFFu };              ///< the score of the dead state
+
+
+   public: // Functions
+    /**
+      @brief Default constructor
+    */
+    BitParallelAutomaton()
+    {
+        length = 0;
+        k = 0;
+        std::fill(masks, masks + 256, 0);
+    }
+
+    /**
+      @brief Constructor from word and maximum edit distance
+      @param input, the lookup word, at most MAX_LENGTH bytes
+      @param distance, the maximum edit distance
+    */
+    BitParallelAutomaton(const Word& input, const unsigned& distance)
+    {
+        length = input.size();
+        k = distance;
+
+        // Bit i of the mask of a byte is set iff the word has this byte at position i
+        std::fill(masks, masks + 256, 0);
+        for (unsigned i = 0; i < length; i++) {
+            masks[static_cast<unsigned char>(input[i])] |= std::uint64_t(1) << i;
+        }
+    }
+
+    /**
+      @brief Tests whether a lookup word is short enough for this automaton
+      @param input, a Word
+    */
+    static bool supports(const Word& input)
+    {
+        return input.size() <= MAX_LENGTH;
+
+    } // supports
+
+    /**
+      @brief Returns the start state, the column of the empty input
+    */
+    State start() const
+    {
+        // The first column counts the rows
+        unsigned row = std::min(k, length);
+        State s = {~std::uint64_t(0), 0, length, row, row};
+        return s;
+
+    } // start
+
+    /**
+      @brief Computes the next column of the matrix
+      @param src, a State
+      @param c, the input byte
+      @return The next column, or the dead state if no continuation can come within distance k
+    */
+    State next_state(const State& src, const unsigned char& c) const
+    {
+        std::uint64_t eq = masks[c];
+        std::uint64_t xv = eq | src.vn;
+        std::uint64_t xh = (((eq & src.vp) + src.vp) ^ src.vp) | eq;
+        std::uint64_t ph = src.vn | ~(xh | src.vp);
+        std::uint64_t mh = src.vp & xh;
+
+        State dest = src;
+        if (length > 0) {
+            std::uint64_t last = std::uint64_t(1) << (length - 1);
+            if ((ph & last) != 0) { dest.score++; }
+            else if ((mh & last) != 0) { dest.score--; }
+        }
+        else {
+            dest.score++;
+        }
+
+        // The cell in the row of the last column's lowest cell within k
+        dest.cell = src.cell + horizontal(ph, mh, src.row);
+
+        // The first row of the matrix counts the input, so it always steps up
+        ph = (ph << 1) | 1;
+        mh = mh << 1;
+        dest.vp = mh | ~(xv | ph);
+        dest.vn = ph & xv;
+
+        // A cell is never smaller than the one diagonally above it, so the lowest cell within k
+        // is at most one row further down; from there go up until a cell is within k
+        if (dest.row < length && dest.cell + vertical(dest, dest.row + 1) <= k) {
+            dest.cell += vertical(dest, dest.row + 1);
+            dest.row++;
+        }
+        while (dest.cell > k && dest.row > 0) {
+            dest.cell -= vertical(dest, dest.row);
+            dest.row--;
+        }
+
+        // The distance can only shrink below k again if some cell of the column is within k
+        if (dest.cell > k) {
+            dest.score = DEAD;
+        }
+
+        return dest;
+
+    } // next_state
+
+    /**
+      @brief Tests whether a state is the dead state
+      @param state, the state to be tested
+    */
+    bool is_dead(const State& state) const
+    {
+        return state.score == DEAD;
+
+    } // is_dead
+
+    /**
+      @brief Tests whether the input leading to a state is within distance k
+      @param state, the state to be tested
+    */
+    bool is_final(const State& state) const
+    {
+        return state.score <= k;
+
+    } // is_final
+
+    /**
+      @brief Returns the edit distance between the lookup word and the input leading to a state
+      @param state, a State that is not dead
+    */
+    unsigned distance(const State& state) const
+    {
+        return state.score;
+
+    } // distance
+
+    /**
+      @brief Returns the smallest cell of a column, a lower bound of the distance of every continuation
+      @param state, a State that is not dead
+    */
+    unsigned min_distance(const State& state) const
+    {
+        // Walk up from the last cell, undoing the vertical steps
+        unsigned best = state.score;
+        unsigned value = state.score;
+        for (unsigned row = length; row > 0 && best > 0; row--) {
+            value -= vertical(state, row);
+            best = std::min(best, value);
+        }
+
+        return best;
+
+    } // min_distance
+
+    /**
+      @brief Computes the edit distance to a whole candidate word, giving up as soon as it must exceed k
+      @param candidate, a Word
+      @param state, receives the state after the candidate if it is within distance k
+      @return true iff the candidate is within distance k
+    */
+    bool scan(const Word& candidate, State& state) const
+    {
+        // The distance is at least the difference of the lengths
+        if (candidate.size() > length + k || candidate.size() + k < length) { return false; }
+
+        state = start();
+        for (std::size_t j = 0; j < candidate.size(); j++) {
+            state = next_state(state, candidate[j]);
+            if (is_dead(state) == true) { return false; }
+
+            // Every remaining byte lowers the distance by at most one
+            std::size_t rest = candidate.size() - j - 1;
+            if (state.score > k + rest) { return false; }
+        }
+
+        return is_final(state);
+
+    } // scan
+
+    /**
+      @brief Returns the maximum edit distance of this automaton
+    */
+    unsigned max_distance() const
+    {
+        return k;
+
+    } // max_distance
+
+
+   private: // Functions
+    /**
+      @brief Returns the difference between a cell and the one left of it
+      @param ph, the positive horizontal steps
+      @param mh, the negative horizontal steps
+      @param row, the row of the cell
+    */
+    static int horizontal(const std::uint64_t& ph, const std::uint64_t& mh, const unsigned& row)
+    {
+        // The first row counts the input
+        if (row == 0) { return 1; }
+
+        std::uint64_t bit = std::uint64_t(1) << (row - 1);
+        if ((ph & bit) != 0) { return 1; }
+        if ((mh & bit) != 0) { return -1; }
+        return 0;
+
+    } // horizontal
+
+    /**
+      @brief Returns the difference between a cell and the one above it
+      @param state, the column
+      @param row, the row of the cell, at least 1
+    */
+    static int vertical(const State& state, const unsigned& row)
+    {
+        std::uint64_t bit = std::uint64_t(1) << (row - 1);
+        if ((state.vp & bit) != 0) { return 1; }
+        if ((state.vn & bit) != 0) { return -1; }
+        return 0;
+
+    } // vertical
+
+
+   private: // variables
+      std::uint64_t     masks[256]; ///< the positions of every byte in the lookup word
+      unsigned          length;     ///< the length of the lookup word
+      unsigned          k;          ///< the max. allowed Lev-distance
+
+  }; // BitParallelAutomaton
+
+#endif // BITPARALLEL_HPP_INCLUDED
@@ -0,0 +1,314 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Corpus stored in columns by word length, compared with a lookup word by brute force
+*/
+
+#ifndef COLUMNARCORPUS_HPP_INCLUDED
+#define COLUMNARCORPUS_HPP_INCLUDED
+
+#define MAX_COLUMNAR_LENGTH 32
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+  @brief ColumnarCorpus keeps the words of a corpus in buckets of equal length,
+         each bucket stored column by column: first byte of every word, then the second byte, ...
+         A scan computes the edit distance to many words of a bucket at once, one vector lane per word:
+         32 with AVX2 where the processor has it, otherwise 16 (SSE2 on x86)
+         Buckets whose length differs from the lookup word's by more than k are skipped
+*/
+class ColumnarCorpus
+  {
+   public: // Types
+      typedef std::pair<std::uint32_t, unsigned>    Hit;    ///< the position of a word in the corpus and its distance
+
+      enum { MAX_DISTANCE = 253 };              ///< the largest k, distances up to k+1 are kept in bytes
+
+   private: // Types
+      typedef std::string                       Word;
+      typedef std::vector<Word>                 WordVec;
+
+      enum { LANES = 32 };                      ///< the most words compared at once, buckets are padded to it
+
+#if defined(__GNUC__)
+      typedef unsigned char Wide __attribute__((vector_size(32)));      ///< 32 lanes, one AVX2 register
+      typedef unsigned char Narrow __attribute__((vector_size(16)));    ///< 16 lanes, one SSE2 register
+#endif
+
+      /// All words of one length, the byte j of word w is at bytes[j * stride + w]
+      struct Bucket
+      {
+          std::size_t                   count;
+          std::size_t                   stride;
+          std::vector<unsigned char>    bytes;
+          std::vector<std::uint32_t>    positions;
+      };
+
+
+   public: // Functions
+    /**
+      @brief Default constructor, creates an empty corpus
+    */
+    ColumnarCorpus()
+    {
+        buckets.resize(MAX_COLUMNAR_LENGTH + 1);
+    }
+
+    /**
+      @brief Constructor from a list of words
+      @param words, the words; hits refer to their positions in this list
+    */
+    ColumnarCorpus(const WordVec& words)
+    {
+        buckets.resize(MAX_COLUMNAR_LENGTH + 1);
+
+        for (std::size_t w = 0; w < words.size(); w++) {
+            if (words[w].size() > MAX_COLUMNAR_LENGTH) {
+                long_words.push_back(words[w]);
+                long_positions.push_back(w);
+            }
+            else {
+                buckets[words[w].size()].positions.push_back(w);
+            }
+        }
+
+        // Pad every bucket to whole blocks, the padding lanes are never reported
+        for (std::size_t length = 0; length <= MAX_COLUMNAR_LENGTH; length++) {
+            Bucket& bucket = buckets[length];
+            bucket.count = bucket.positions.size();
+            bucket.stride = (bucket.count + LANES - 1) / LANES * LANES;
+            bucket.bytes.assign(length * bucket.stride, 0);
+
+            for (std::size_t w = 0; w < bucket.count; w++) {
+                const Word& word = words[bucket.positions[w]];
+                for (std::size_t j = 0; j < length; j++) {
+                    bucket.bytes[j * bucket.stride + w] = word[j];
+                }
+            }
+        }
+    }
+
+    /**
+      @brief Finds all words within distance k of a lookup word
+      @param input, the lookup word
+      @param k, the maximum edit distance, at most MAX_DISTANCE
+      @param hits, receives the position and distance of every word within k, in no particular order
+    */
+    void scan(const Word& input, const unsigned& k, std::vector<Hit>& hits) const
+    {
+        std::size_t first = input.size() > k ? input.size() - k : 0;
+        std::size_t last = std::min<std::size_t>(input.size() + k, MAX_COLUMNAR_LENGTH);
+        for (std::size_t length = first; length <= last; length++) {
+            if (buckets[length].count == 0) { continue; }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            if (has_avx2() == true) {
+                scan_avx2(buckets[length], length, input, k, hits);
+                continue;
+            }
+#endif
+#if defined(__GNUC__)
+            scan_vector(buckets[length], length, input, k, hits);
+#else
+            scan_scalar(buckets[length], length, input, k, hits);
+#endif
+        }
+
+        for (std::size_t w = 0; w < long_words.size(); w++) {
+            unsigned d = bounded_distance(input, long_words[w], k);
+            if (d <= k) { hits.push_back(Hit(long_positions[w], d)); }
+        }
+
+    } // scan
+
+
+   private: // Functions
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    /**
+      @brief Tests once whether the processor supports AVX2
+    */
+    static bool has_avx2()
+    {
+        static const bool supported = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+        return supported;
+
+    } // has_avx2
+
+    /**
+      @brief The scan of one bucket compiled for AVX2
+    */
+    __attribute__((target("avx2")))
+    static void scan_avx2(const Bucket& bucket, const std::size_t& length, const Word& input,
+                          const unsigned& k, std::vector<Hit>& hits)
+    {
+        scan_lanes<Wide>(bucket, length, input, k, hits);
+
+    } // scan_avx2
+#endif
+
+#if defined(__GNUC__)
+    /**
+      @brief The scan of one bucket compiled for the default target, e.g. SSE2
+    */
+    static void scan_vector(const Bucket& bucket, const std::size_t& length, const Word& input,
+                            const unsigned& k, std::vector<Hit>& hits)
+    {
+        scan_lanes<Narrow>(bucket, length, input, k, hits);
+
+    } // scan_vector
+
+    /**
+      @brief Computes the distances to the words of a bucket, one word per lane of a Vector
+             Always inlined, so it is compiled for the target of its caller
+             Cells are capped at k+1, which is all the rows need to decide about k
+    */
+    template<class Lanes>
+    __attribute__((always_inline))
+    static inline void scan_lanes(const Bucket& bucket, const std::size_t& length, const Word& input,
+                                  const unsigned& k, std::vector<Hit>& hits)
+    {
+        const unsigned char limit = static_cast<unsigned char>(std::min(k + 1, 254u));
+        Lanes one = {}, cap = {}, within = {}, c = {};
+        splat(one, 1);
+        splat(cap, limit);
+        splat(within, limit - 1);
+        Lanes row[MAX_COLUMNAR_LENGTH + 1];
+
+        const std::size_t lanes = sizeof(Lanes);
+        for (std::size_t block = 0; block < bucket.count; block += lanes) {
+            // The first row of the matrix counts the candidates' bytes
+            for (std::size_t j = 0; j <= length; j++) {
+                splat(row[j], std::min<std::size_t>(j, limit));
+            }
+
+            bool alive = true;
+            for (std::size_t i = 1; i <= input.size() && alive == true; i++) {
+                splat(c, input[i - 1]);
+                Lanes diagonal = row[0];
+                splat(row[0], std::min<std::size_t>(i, limit));
+                Lanes best = row[0];
+
+                for (std::size_t j = 1; j <= length; j++) {
+                    Lanes column;
+                    std::memcpy(&column, &bucket.bytes[(j - 1) * bucket.stride + block], lanes);
+
+                    // Lane-wise minimum of deletion, insertion and substitution, capped at k+1
+                    Lanes up = row[j] + one;
+                    Lanes left = row[j - 1] + one;
+                    Lanes cost = diagonal + ((Lanes)(column != c) & one);
+                    Lanes cell = up < left ? up : left;
+                    cell = cost < cell ? cost : cell;
+                    cell = cap < cell ? cap : cell;
+
+                    diagonal = row[j];
+                    row[j] = cell;
+                    best = cell < best ? cell : best;
+                }
+
+                // Once no cell of the row is within k, none of the words can be
+                alive = any((Lanes)(best <= within));
+            }
+            if (alive == false) { continue; }
+
+            for (std::size_t lane = 0; lane < lanes && block + lane < bucket.count; lane++) {
+                if (row[length][lane] <= k) {
+                    hits.push_back(Hit(bucket.positions[block + lane], row[length][lane]));
+                }
+            }
+        } // for block
+
+    } // scan_lanes
+
+    /**
+      @brief Sets all lanes of a vector to a value
+             Vectors are passed by reference only, their calling convention differs between targets
+    */
+    template<class Lanes>
+    __attribute__((always_inline))
+    static inline void splat(Lanes& v, const unsigned char& value)
+    {
+        for (unsigned lane = 0; lane < sizeof(Lanes); lane++) { v[lane] = value; }
+
+    } // splat
+
+    /**
+      @brief Tests whether any lane of a comparison result is set
+    */
+    template<class Lanes>
+    __attribute__((always_inline))
+    static inline bool any(const Lanes& mask)
+    {
+        std::uint64_t parts[sizeof(Lanes) / 8];
+        std::memcpy(parts, &mask, sizeof(Lanes));
+
+        std::uint64_t set = 0;
+        for (unsigned p = 0; p < sizeof(Lanes) / 8; p++) { set |= parts[p]; }
+        return set != 0;
+
+    } // any
+#else
+    /**
+      @brief Computes the distances to the words of a bucket one after the other
+    */
+    static void scan_scalar(const Bucket& bucket, const std::size_t& length, const Word& input,
+                            const unsigned& k, std::vector<Hit>& hits)
+    {
+        Word word(length, '\0');
+        for (std::size_t w = 0; w < bucket.count; w++) {
+            for (std::size_t j = 0; j < length; j++) {
+                word[j] = bucket.bytes[j * bucket.stride + w];
+            }
+
+            unsigned d = bounded_distance(input, word, k);
+            if (d <= k) { hits.push_back(Hit(bucket.positions[w], d)); }
+        }
+
+    } // scan_scalar
+#endif
+
+    /**
+      @brief Computes the edit distance of two words row by row, giving up once it must exceed k
+      @return The distance, or k+1 if it is larger than k
+    */
+    static unsigned bounded_distance(const Word& a, const Word& b, const unsigned& k)
+    {
+        if (std::max(a.size(), b.size()) - std::min(a.size(), b.size()) > k) { return k + 1; }
+
+        std::vector<unsigned> row(b.size() + 1);
+        for (std::size_t j = 0; j <= b.size(); j++) { row[j] = j; }
+
+        for (std::size_t i = 1; i <= a.size(); i++) {
+            unsigned diagonal = row[0];
+            row[0] = i;
+            unsigned best = row[0];
+            for (std::size_t j = 1; j <= b.size(); j++) {
+                unsigned cell = std::min(std::min(row[j], row[j - 1]) + 1, diagonal + (a[i - 1] != b[j - 1]));
+                diagonal = row[j];
+                row[j] = cell;
+                best = std::min(best, cell);
+            }
+            if (best > k) { return k + 1; }
+        }
+
+        return std::min(row[b.size()], k + 1);
+
+    } // bounded_distance
+
+
+   private: // variables
+      std::vector<Bucket>           buckets;        ///< the words of every length up to MAX_COLUMNAR_LENGTH
+      WordVec                       long_words;     ///< the longer words, compared one by one
+      std::vector<std::uint32_t>    long_positions; ///< and their positions
+
+  }; // ColumnarCorpus
+
+#endif // COLUMNARCORPUS_HPP_INCLUDED
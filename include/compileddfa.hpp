@@ -0,0 +1,504 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Flat, integer indexed representation of a deterministic final automaton
+*/
+
+#ifndef COMPILEDDFA_HPP_INCLUDED
+#define COMPILEDDFA_HPP_INCLUDED
+
+#define NONE      "\0"
+#define NUL       '\0'
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "label.hpp"
+#include "levstats.hpp"
+#include "nextvalid.hpp"
+
+/**
+  @brief CompiledDFA stores a deterministic final automaton in flat arrays
+         States are dense integers, every state owns a sorted range of byte labelled edges
+         and an optional default edge for a range of bytes, final states are kept in a bitset
+         Traversing it does not compare any sets or strings and does not allocate
+*/
+class CompiledDFA
+  {
+   public: // Types
+      typedef std::uint32_t                     StateId;
+      typedef StateId                           State;
+
+      /// An edge of the automaton, the edges of each state are sorted by symbol
+      struct Edge
+      {
+          unsigned char     symbol;
+          StateId           target;
+      };
+
+      enum { NOSTATE = 0xFFFFFFFFu };           ///< default for invalid or nonexisting states
+
+   private: // Types
+      typedef std::string                       Word;
+
+
+   public: // Functions
+    /**
+      @brief Default constructor, creates an automaton without states
+    */
+    CompiledDFA()
+    {
+        offsets.push_back(0);
+    }
+
+    /**
+      @brief Adds a new state to the automaton; the first one added is the start state
+      @param final, whether the new state is final
+      @param distance, the edit distance a final state stands for
+      @param bound, a lower bound of the distance of every final state reachable from the new state
+      @return The id of the new state
+    */
+    StateId add_state(const bool& final, const unsigned& distance = 0, const unsigned& bound = 0)
+    {
+        StateId id = defaults.size();
+        defaults.push_back(NOSTATE);
+        lows.push_back(0);
+        highs.push_back(255);
+        offsets.push_back(edges.size());
+        distances.push_back(distance);
+        bounds.push_back(bound);
+
+        if (finals.size() * 64 <= id) { finals.push_back(0); }
+        if (final == true) { finals[id / 64] |= std::uint64_t(1) << (id % 64); }
+
+        return id;
+
+    } // add_state
+
+    /**
+      @brief Adds a transition to the most recently added state
+             Edges of a state have to be added right after the state itself
+             and in ascending order of their symbols
+      @param symbol, the input byte
+      @param dest, the reached state
+    */
+    void add_transition(const unsigned char& symbol, const StateId& dest)
+    {
+        Edge edge = {symbol, dest};
+        edges.push_back(edge);
+        offsets.back() = edges.size();
+
+    } // add_transition
+
+    /**
+      @brief Establishes a default transition for all symbols without an edge
+             If it is limited to a range of bytes, the other bytes without an edge lead nowhere
+      @param src, a StateId
+      @param dest, the reached StateId
+      @param low, the smallest byte the default transition is taken for
+      @param high, the largest one
+    */
+    void set_default_transition(const StateId& src, const StateId& dest,
+                                const unsigned char& low = 0, const unsigned char& high = 255)
+    {
+        defaults[src] = dest;
+        lows[src] = low;
+        highs[src] = high;
+
+    } // set_default_transition
+
+    /**
+      @brief Returns the start state, which is NOSTATE for an empty automaton
+    */
+    StateId start() const
+    {
+        return defaults.size() > 0 ? StateId(0) : StateId(NOSTATE);
+
+    } // start
+
+    /**
+      @brief Number of states
+    */
+    std::size_t size() const
+    {
+        return defaults.size();
+
+    } // size
+
+    /**
+      @brief Tests whether a given state is among the final states
+      @param state, the StateId to be tested
+      @return true iff the state is final
+    */
+    bool is_final(const StateId& state) const
+    {
+        return (finals[state / 64] >> (state % 64) & 1u) == 1u;
+
+    } // is_final
+
+    /**
+      @brief Tests whether a state returned by next_state is the missing state
+      @param state, a StateId
+      @return true iff no word can be accepted from here
+    */
+    bool is_dead(const StateId& state) const
+    {
+        return state == NOSTATE;
+
+    } // is_dead
+
+    /**
+      @brief Returns the edit distance a final state stands for
+      @param state, a final StateId
+    */
+    unsigned distance(const StateId& state) const
+    {
+        return distances[state];
+
+    } // distance
+
+    /**
+      @brief Returns a lower bound of the distance of every final state reachable from a state
+      @param state, a StateId
+    */
+    unsigned min_distance(const StateId& state) const
+    {
+        return bounds[state];
+
+    } // min_distance
+
+    /**
+      @brief Looks for the next reachable state from a given state and an input byte
+      @param src, a StateId
+      @param symbol, the input byte
+      @return The state reachable from this state and input, or NOSTATE
+    */
+    StateId next_state(const StateId& src, const unsigned char& symbol) const
+    {
+        const Edge* first = edges.data() + offsets[src];
+        const Edge* last = edges.data() + offsets[src + 1];
+        const Edge* pos = lower_edge(first, last, symbol);
+
+        if (pos != last && pos->symbol == symbol) { return pos->target; }
+        if (symbol < lows[src] || symbol > highs[src]) { return NOSTATE; }
+
+        return defaults[src];
+
+    } // next_state
+
+    /**
+      @brief Retrieves the smallest valid edge of a state starting at a given symbol
+      @param state, a StateId
+      @param first, the smallest symbol to be considered
+      @return The symbol of the next valid edge, or -1 if there is none
+    */
+    int find_next_edge(const StateId& state, const int& first) const
+    {
+        if (first > 255) { return -1; }
+
+        // With a default transition every symbol of its range is valid
+        const bool fallback = defaults[state] != NOSTATE && first <= highs[state];
+        if (fallback == true && first >= lows[state]) { return first; }
+
+        const Edge* last = edges.data() + offsets[state + 1];
+        const Edge* pos = lower_edge(edges.data() + offsets[state], last, first);
+        if (fallback == true && (pos == last || pos->symbol > lows[state])) { return lows[state]; }
+        if (pos != last) { return pos->symbol; }
+
+        return -1;
+
+    } // find_next_edge
+
+    /**
+      @brief Searches the automaton for the next valid Word given an input Word
+             Uses the given buffers only, so it does not allocate once they are large enough;
+             they keep the path of the previous call, which is only walked back to where the input leaves it
+      @param input, a Word
+      @param result, the previous result or empty, receives the next valid Word from this one
+      @param stack, the states along the previous result or empty, receives the states along the new one
+      @return true iff there is a next valid Word
+    */
+    bool next_valid(const Word& input, Word& result, std::vector<StateId>& stack) const
+    {
+        return ::next_valid(*this, input, result, stack);
+
+    } // next_valid
+
+    /**
+      @brief Searches the automaton for the next valid Word given an input Word
+      @param input, a Word
+      @return The next valid Word from this one, or NONE
+    */
+    Word next_valid(const Word& input) const
+    {
+        Word result;
+        std::vector<StateId> stack;
+        if (next_valid(input, result, stack) == true) {
+            return result;
+        }
+
+        return NONE;
+
+    } // next_valid
+
+    /**
+      @brief Merges all states that accept the same words with the same distances (Hopcroft's algorithm)
+             The first partition already separates states by finality, distance and bound,
+             so the merged automaton reports the same distances and prunes as early as before
+      @return The minimal automaton, its states numbered breadth first from the start state
+    */
+    CompiledDFA minimize() const
+    {
+        const std::size_t n = size();
+        if (n == 0) { return *this; }
+
+        // One symbol for every byte with an edge, and one for all other bytes between two bounds
+        // of the ranges of the default transitions
+        std::vector<int> symbols;
+        std::vector<bool> used(256, false);
+        std::vector<bool> bound(257, false);
+        for (auto& edge: edges) { used[edge.symbol] = true; }
+        for (StateId s = 0; s < n; s++) {
+            bound[lows[s]] = true;
+            bound[highs[s] + 1] = true;
+        }
+        bool covered = false;
+        for (int c = 0; c < 256; c++) {
+            if (bound[c] == true) { covered = false; }
+            if (used[c] == true) { symbols.push_back(c); }
+            else if (covered == false) {
+                symbols.push_back(c);
+                covered = true;
+            }
+        }
+
+        // The missing state becomes the sink n, the transitions are inverted per symbol
+        const std::size_t states = n + 1;
+        std::vector<std::uint32_t> pred_first(symbols.size() * (states + 1), 0);
+        std::vector<StateId> preds(symbols.size() * states);
+        for (std::size_t a = 0; a < symbols.size(); a++) {
+            std::uint32_t* first = &pred_first[a * (states + 1)];
+            for (StateId s = 0; s < states; s++) {
+                first[target(s, symbols[a], n) + 1]++;
+            }
+            for (std::size_t t = 0; t < states; t++) { first[t + 1] += first[t]; }
+
+            std::vector<std::uint32_t> fill(first, first + states);
+            for (StateId s = 0; s < states; s++) {
+                preds[a * states + fill[target(s, symbols[a], n)]++] = s;
+            }
+        }
+
+        // The partition: the states of block b are elements[begin[b]] to elements[end[b]]
+        std::vector<StateId> elements(states);
+        std::vector<std::uint32_t> position(states);
+        std::vector<std::uint32_t> block(states);
+        std::vector<std::uint32_t> begin;
+        std::vector<std::uint32_t> end;
+
+        std::map<std::tuple<bool, unsigned, unsigned>, std::uint32_t> kinds;
+        for (StateId s = 0; s < n; s++) {
+            std::tuple<bool, unsigned, unsigned> kind(is_final(s), is_final(s) ? distances[s] : 0, bounds[s]);
+            auto pos = kinds.insert(std::make_pair(kind, kinds.size())).first;
+            block[s] = pos->second;
+        }
+        block[n] = kinds.size();
+
+        begin.assign(kinds.size() + 1, 0);
+        for (StateId s = 0; s < states; s++) {
+            if (block[s] + 1 < begin.size()) { begin[block[s] + 1]++; }
+        }
+        for (std::size_t b = 1; b < begin.size(); b++) { begin[b] += begin[b - 1]; }
+        end = begin;
+        for (StateId s = 0; s < states; s++) {
+            position[s] = end[block[s]]++;
+            elements[position[s]] = s;
+        }
+
+        // Every block is a splitter at first
+        std::vector<std::uint32_t> work;
+        std::vector<bool> waiting(begin.size(), true);
+        for (std::uint32_t b = 0; b < begin.size(); b++) { work.push_back(b); }
+
+        std::vector<std::uint32_t> marked(begin.size(), 0);
+        std::vector<bool> is_marked(states, false);
+        std::vector<std::uint32_t> touched;
+        std::vector<StateId> splitter;
+
+        while (work.empty() == false) {
+            std::uint32_t b = work.back();
+            work.pop_back();
+            waiting[b] = false;
+            splitter.assign(elements.begin() + begin[b], elements.begin() + end[b]);
+
+            for (std::size_t a = 0; a < symbols.size(); a++) {
+                // Move the predecessors of the splitter to the front of their blocks
+                const std::uint32_t* first = &pred_first[a * (states + 1)];
+                for (auto t: splitter) {
+                    for (std::uint32_t i = first[t]; i < first[t + 1]; i++) {
+                        StateId s = preds[a * states + i];
+                        if (is_marked[s] == true) { continue; }
+                        is_marked[s] = true;
+
+                        std::uint32_t c = block[s];
+                        if (marked[c] == 0) { touched.push_back(c); }
+                        std::uint32_t swap = begin[c] + marked[c]++;
+                        std::swap(elements[position[s]], elements[swap]);
+                        position[elements[position[s]]] = position[s];
+                        position[s] = swap;
+                    }
+                }
+
+                // Blocks that are only partly marked are split into the marked and the other states
+                for (auto c: touched) {
+                    std::uint32_t middle = begin[c] + marked[c];
+                    for (std::uint32_t i = begin[c]; i < middle; i++) { is_marked[elements[i]] = false; }
+                    marked[c] = 0;
+                    if (middle == end[c]) { continue; }
+
+                    std::uint32_t d = begin.size();
+                    begin.push_back(begin[c]);
+                    end.push_back(middle);
+                    begin[c] = middle;
+                    marked.push_back(0);
+                    for (std::uint32_t i = begin[d]; i < end[d]; i++) { block[elements[i]] = d; }
+
+                    // Hopcroft's trick: unless the old block is waiting anyway, only the smaller half has to be
+                    if (waiting[c] == true || end[d] - begin[d] <= end[c] - begin[c]) {
+                        waiting.push_back(true);
+                        work.push_back(d);
+                    }
+                    else {
+                        waiting.push_back(false);
+                        waiting[c] = true;
+                        work.push_back(c);
+                    }
+                }
+                touched.clear();
+            } // for symbols
+        } // while
+
+        // One state per block reachable from the start, a member stands for the whole block
+        CompiledDFA dfa;
+        std::vector<StateId> ids(begin.size(), NOSTATE);
+        std::vector<StateId> order(1, 0);
+        ids[block[0]] = 0;
+        auto id = [&](const StateId& s) {
+            if (s == NOSTATE) { return StateId(NOSTATE); }
+            if (ids[block[s]] == NOSTATE) {
+                ids[block[s]] = order.size();
+                order.push_back(s);
+            }
+            return ids[block[s]];
+        };
+
+        for (StateId i = 0; i < order.size(); i++) {
+            StateId s = order[i];
+            dfa.add_state(is_final(s), distances[s], bounds[s]);
+
+            StateId fallback = id(defaults[s]);
+            for (std::uint32_t e = offsets[s]; e < offsets[s + 1]; e++) {
+                StateId dest = id(edges[e].target);
+                bool covered = edges[e].symbol >= lows[s] && edges[e].symbol <= highs[s];
+                if (dest != fallback || covered == false) { dfa.add_transition(edges[e].symbol, dest); }
+            }
+            dfa.set_default_transition(i, fallback, lows[s], highs[s]);
+        }
+
+        return dfa;
+
+    } // minimize
+
+    /**
+        @brief Prints the whole automaton in a readable way
+    */
+    void dfa_printer() const
+    {
+        std::cout << "My DFA contains these transitions:\n";
+        for (StateId s = 0; s < size(); s++) {
+            for (std::uint32_t e = offsets[s]; e < offsets[s + 1]; e++) {
+                std::cout << s << " -> " << edges[e].symbol << " -> " << edges[e].target << "\n";
+            }
+            if (defaults[s] != NOSTATE) {
+                std::cout << s << " -> " << Label::any() << " -> " << defaults[s] << "\n";
+            }
+            if (is_final(s) == true) { std::cout << s << " is final with distance " << distance(s) << "\n"; }
+            std::cout << "\n";
+        }
+
+    } // dfa_printer
+
+    /**
+        @brief Prints a dot representation of the DFA to stream 'out'
+        @param ostream out
+    */
+    void dfa_to_dot(std::ostream& out) const
+    {
+        out << "digraph FSM {" << std::endl;
+        out << "graph [rankdir=LR, fontsize=14, center=1, orientation=Portrait];" << std::endl;
+        out << "node  [font = \"Arial\", shape = circle, style=filled, fontcolor=black, color=lightgray]" << std::endl;
+        out << "edge  [fontname = \"Arial\"]" << std::endl << std::endl;
+
+        for (StateId s = 0; s < size(); s++) {
+            out << s << " [label = \"" << s << "\"";
+            if (is_final(s) == true) { out << ", shape = doublecircle]" << std::endl; }
+            else { out << "]" << std::endl; }
+
+            for (std::uint32_t e = offsets[s]; e < offsets[s + 1]; e++) {
+                out << s << " -> " << edges[e].target << " [label = \"" << edges[e].symbol << "\"]\n";
+            }
+            if (defaults[s] != NOSTATE) {
+                out << s << " -> " << defaults[s] << " [label = \"" << Label::any() << "\"]\n";
+            }
+        }
+
+        out << "}" << std::endl;
+
+    } // dfa_to_dot
+
+
+   private: // Functions
+    /**
+      @brief Finds the first edge in a sorted range whose symbol is not smaller than a given one
+    */
+    static const Edge* lower_edge(const Edge* first, const Edge* last, const int& symbol)
+    {
+        return std::lower_bound(first, last, symbol,
+                                [](const Edge& edge, const int& s) { return edge.symbol < s; });
+
+    } // lower_edge
+
+    /**
+      @brief The transition of minimize(), where the missing state and the sink are the state n
+    */
+    StateId target(const StateId& src, const int& symbol, const std::size_t& n) const
+    {
+        if (src == n) { return n; }
+
+        StateId dest = next_state(src, symbol);
+        return dest == NOSTATE ? n : dest;
+
+    } // target
+
+
+   private: // variables
+      std::vector<std::uint32_t>    offsets;    ///< the edges of state s are edges[offsets[s] .. offsets[s+1])
+      std::vector<Edge>             edges;      ///< all edges, grouped by state and sorted by symbol
+      std::vector<StateId>          defaults;   ///< the default transition of every state or NOSTATE
+      std::vector<unsigned char>    lows;       ///< the smallest byte the default transition of every state is taken for
+      std::vector<unsigned char>    highs;      ///< and the largest one
+      std::vector<std::uint64_t>    finals;     ///< bitset of the final states
+      std::vector<unsigned char>    distances;  ///< the edit distance of every final state
+      std::vector<unsigned char>    bounds;     ///< the smallest distance reachable from every state
+
+  }; // CompiledDFA
+
+#endif // COMPILEDDFA_HPP_INCLUDED
@@ -0,0 +1,237 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Shared, immutable corpus of words for Levenshtein automata
+*/
+
+#ifndef CORPUS_HPP_INCLUDED
+#define CORPUS_HPP_INCLUDED
+
+#define NONE      "\0"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "columnarcorpus.hpp"
+#include "corpusindex.hpp"
+#include "mappedfile.hpp"
+
+/**
+  @brief Corpus holds the sorted list of words a lookup is done against,
+         and optionally its CorpusIndex
+         It is built once and never changed afterwards, so a single instance can be
+         shared through a CorpusPtr by any number of automata and threads
+         A Corpus loaded from an index file has no list of words and answers
+         every lookup from the mapped index
+*/
+class Corpus
+  {
+   private: // Types
+      typedef std::string                       Word;
+      typedef std::vector<Word>                 WordVec;
+
+
+   public: // Functions
+    /**
+      @brief Constructor from a list of words
+      @param input, the words; they are sorted and duplicates are removed
+      @param indexed, whether a CorpusIndex is built for lockstep traversal
+      @param columnar, whether a ColumnarCorpus is built for brute force scans
+    */
+    Corpus(const WordVec& input, const bool& indexed = true, const bool& columnar = false)
+    {
+        words = input;
+        if (std::is_sorted(words.begin(), words.end()) == false) {
+            std::sort(words.begin(), words.end());
+        }
+        words.erase(std::unique(words.begin(), words.end()), words.end());
+
+        if (indexed == true) {
+            index.reset(new CorpusIndex(words));
+        }
+        if (columnar == true) {
+            columns.reset(new ColumnarCorpus(words));
+        }
+    }
+
+    /**
+      @brief Loads a corpus from an index file written by save()
+             The file is mapped and used in place; loading only reads it once to check that it is well-formed
+      @param path, the name of the file
+      @return The corpus, or an empty pointer if the file could not be read or is corrupt
+    */
+    static std::shared_ptr<const Corpus> load(const std::string& path)
+    {
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+        if (file->is_open() == false) { return nullptr; }
+
+        std::unique_ptr<const CorpusIndex> loaded(new CorpusIndex(file->data(), file->size(), file));
+        if (loaded->is_valid() == false) { return nullptr; }
+
+        return std::shared_ptr<const Corpus>(new Corpus(std::move(loaded)));
+
+    } // load
+
+    /**
+      @brief Tests whether a file is an index file that load() can read
+      @param path, the name of the file
+    */
+    static bool is_index_file(const std::string& path)
+    {
+        MappedFile file(path);
+        return file.is_open() == true && CorpusIndex::is_index_file(file.data(), file.size());
+
+    } // is_index_file
+
+    /**
+      @brief Writes the index of the corpus to a file that load() can read
+      @param path, the name of the file
+      @return true iff the corpus has an index and it could be written
+    */
+    bool save(const std::string& path) const
+    {
+        if (has_index() == false) { return false; }
+
+        std::ofstream out(path.c_str(), std::ios::binary);
+        return index->write(out);
+
+    } // save
+
+    /**
+      @brief Returns the sorted words, empty for a corpus loaded from a file
+    */
+    const WordVec& get_words() const
+    {
+        return words;
+
+    } // get_words
+
+    /**
+      @brief Tests whether a CorpusIndex was built
+    */
+    bool has_index() const
+    {
+        return index != nullptr;
+
+    } // has_index
+
+    /**
+      @brief Returns the index of the corpus, only valid if has_index()
+    */
+    const CorpusIndex& get_index() const
+    {
+        return *index;
+
+    } // get_index
+
+    /**
+      @brief Tests whether a ColumnarCorpus was built
+    */
+    bool has_columns() const
+    {
+        return columns != nullptr;
+
+    } // has_columns
+
+    /**
+      @brief Returns the words stored in columns, only valid if has_columns()
+             The positions of its hits are positions in get_words()
+    */
+    const ColumnarCorpus& get_columns() const
+    {
+        return *columns;
+
+    } // get_columns
+
+    /**
+      @brief Tests whether a word is in the corpus
+      @param word, a Word
+      @return true iff the word is in the corpus
+    */
+    bool contains(const Word& word) const
+    {
+        if (words.empty() == true && has_index() == true) { return index->contains(word); }
+
+        return std::binary_search(words.begin(), words.end(), word);
+
+    } // contains
+
+    /**
+      @brief Returns the first word in the corpus that is lexicographically greater than or equal to the input word
+      @param input, a Word
+      @return The found word, NONE if there is none
+    */
+    Word next_in_corpus(const Word& input) const
+    {
+        if (words.empty() == true && has_index() == true) {
+            Word result;
+            if (index->next_in_corpus(input, result) == true) { return result; }
+            return NONE;
+        }
+
+        auto pos = std::lower_bound(words.begin(), words.end(), input);
+        if (pos != words.end()) {
+            return *pos;
+        }
+
+        return NONE;
+
+    } // next_in_corpus
+
+    /**
+      @brief Finds the first word in the corpus that is lexicographically greater than or equal to the input word
+             Uses the given buffer only, so it does not allocate once it is large enough
+      @param input, a Word
+      @param result, receives the found word
+      @return true iff there is such a word
+    */
+    bool next_in_corpus(const Word& input, Word& result) const
+    {
+        if (words.empty() == true && has_index() == true) { return index->next_in_corpus(input, result); }
+
+        auto pos = std::lower_bound(words.begin(), words.end(), input);
+        if (pos == words.end()) { return false; }
+
+        result.assign(*pos);
+        return true;
+
+    } // next_in_corpus
+
+    /**
+      @brief Number of words in the corpus
+    */
+    std::size_t size() const
+    {
+        if (words.empty() == true && has_index() == true) { return index->size(); }
+
+        return words.size();
+
+    } // size
+
+
+   private: // Functions
+    /**
+      @brief Constructor from a loaded index, without a list of words
+    */
+    Corpus(std::unique_ptr<const CorpusIndex> loaded)
+    {
+        index = std::move(loaded);
+    }
+
+
+   private: // variables
+      WordVec                               words;  ///< the sorted list of all possible words
+      std::unique_ptr<const CorpusIndex>    index;  ///< the index of these words, if requested
+      std::unique_ptr<const ColumnarCorpus> columns;///< these words in columns, if requested
+
+  }; // Corpus
+
+typedef std::shared_ptr<const Corpus>   CorpusPtr;  ///< the handle a Corpus is shared with
+
+#endif // CORPUS_HPP_INCLUDED
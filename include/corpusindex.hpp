@@ -0,0 +1,544 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Minimal acyclic automaton (DAWG) indexing a corpus of words
+Can be written to a binary file and used straight from a memory mapping of it
+*/
+
+#ifndef CORPUSINDEX_HPP_INCLUDED
+#define CORPUSINDEX_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+  @brief CorpusIndex stores a sorted corpus as a minimal deterministic acyclic automaton
+         Common prefixes and common suffixes of the words are shared, so a Levenshtein
+         automaton can be walked through it in lockstep and drop a whole subtree at once
+         It is built once from a sorted list of words, or loaded from a file written by write(),
+         and immutable afterwards
+         The arrays are only referenced, so a loaded index points right into the file's pages
+*/
+class CorpusIndex
+  {
+   public: // Types
+      typedef std::uint32_t                     NodeId;
+
+      enum : std::uint64_t { MAX_COUNT = 0xFFFFFFFF };  ///< the most nodes or edges an index can have
+
+      /// An edge of the index, the edges of each node are sorted by symbol
+      struct Edge
+      {
+          unsigned char     symbol;
+          NodeId            target;
+      };
+
+      /// The header of a binary index file, followed by the offsets, the edges and the final bitset
+      struct FileHeader
+      {
+          char              magic[8];
+          std::uint64_t     nodes;
+          std::uint64_t     edges;
+          std::uint64_t     words;
+      };
+
+   private: // Types
+      typedef std::string                       Word;
+      typedef std::vector<Word>                 WordVec;
+      typedef std::vector<std::uint32_t>        Signature;
+
+      /// A node while the index is built
+      struct BuildNode
+      {
+          bool                                          final;
+          std::vector<std::pair<unsigned char, NodeId>> children;
+      };
+
+
+   public: // Functions
+    /**
+      @brief Default constructor, creates an empty index
+    */
+    CorpusIndex()
+    {
+        build(WordVec());
+    }
+
+    /**
+      @brief Constructor from a corpus
+      @param corpus, the words sorted in ascending order; duplicates are ignored
+    */
+    CorpusIndex(const WordVec& corpus)
+    {
+        build(corpus);
+    }
+
+    /**
+      @brief Constructor from the contents of a binary index file, which are not copied
+             The contents are checked once; if they are truncated or corrupt, is_valid() is false
+      @param data, the file contents, aligned to 8 bytes
+      @param size, the size of the file
+      @param owner, keeps the memory alive as long as the index exists
+    */
+    CorpusIndex(const char* data, const std::size_t& size, const std::shared_ptr<const void>& owner)
+    {
+        nodes = 0;
+        words = 0;
+        offsets = 0;
+        edges = 0;
+        finals = 0;
+        storage = owner;
+
+        if (is_index_file(data, size) == false) { return; }
+
+        FileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        // Node ids and offsets have 32 bits, which also keeps the sizes below from overflowing
+        if (header.nodes == 0 || header.nodes > MAX_COUNT || header.edges > MAX_COUNT) { return; }
+
+        std::uint64_t offset_pos = sizeof(FileHeader);
+        std::uint64_t edge_pos = offset_pos + aligned((header.nodes + 1) * sizeof(std::uint32_t));
+        std::uint64_t final_pos = edge_pos + header.edges * sizeof(Edge);
+        std::uint64_t end = final_pos + (header.nodes + 63) / 64 * sizeof(std::uint64_t);
+        if (end > size) { return; }
+
+        offsets = reinterpret_cast<const std::uint32_t*>(data + offset_pos);
+        edges = reinterpret_cast<const Edge*>(data + edge_pos);
+        finals = reinterpret_cast<const std::uint64_t*>(data + final_pos);
+        nodes = header.nodes;
+
+        if (check(header.edges, header.words) == false) {
+            offsets = 0;
+            edges = 0;
+            finals = 0;
+            nodes = 0;
+            return;
+        }
+
+        words = header.words;
+    }
+
+    /// An index may point into its own storage, so it is never copied
+    CorpusIndex(const CorpusIndex&) = delete;
+    CorpusIndex& operator=(const CorpusIndex&) = delete;
+
+    /**
+      @brief Tests whether a block of memory holds a binary index file
+      @param data, the memory
+      @param size, its size
+      @return true iff the memory starts with the header of an index file
+    */
+    static bool is_index_file(const char* data, const std::size_t& size)
+    {
+        return size >= sizeof(FileHeader) && std::memcmp(data, magic(), sizeof(FileHeader::magic)) == 0;
+
+    } // is_index_file
+
+    /**
+      @brief Tests whether the index could be built or loaded
+    */
+    bool is_valid() const
+    {
+        return offsets != 0;
+
+    } // is_valid
+
+    /**
+      @brief Writes the index in the binary format the file constructor reads
+             Numbers are stored in the byte order of this machine
+      @param out, a binary stream
+      @return true iff everything could be written
+    */
+    bool write(std::ostream& out) const
+    {
+        FileHeader header;
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.nodes = nodes;
+        header.edges = offsets[nodes];
+        header.words = words;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        const char padding[8] = {0};
+        std::size_t offset_bytes = (nodes + 1) * sizeof(std::uint32_t);
+        out.write(reinterpret_cast<const char*>(offsets), offset_bytes);
+        out.write(padding, aligned(offset_bytes) - offset_bytes);
+
+        // Edges are written one by one, so that their padding bytes are zero
+        for (std::uint32_t e = 0; e < header.edges; e++) {
+            char buffer[sizeof(Edge)] = {0};
+            std::memcpy(buffer + offsetof(Edge, symbol), &edges[e].symbol, sizeof(edges[e].symbol));
+            std::memcpy(buffer + offsetof(Edge, target), &edges[e].target, sizeof(edges[e].target));
+            out.write(buffer, sizeof(buffer));
+        }
+
+        out.write(reinterpret_cast<const char*>(finals), (nodes + 63) / 64 * sizeof(std::uint64_t));
+
+        return out.good();
+
+    } // write
+
+    /**
+      @brief Returns the root node
+    */
+    NodeId root() const
+    {
+        return 0;
+
+    } // root
+
+    /**
+      @brief Tests whether a node ends a word of the corpus
+      @param node, a NodeId
+      @return true iff the path to this node is a word
+    */
+    bool is_final(const NodeId& node) const
+    {
+        return (finals[node / 64] >> (node % 64) & 1u) == 1u;
+
+    } // is_final
+
+    /**
+      @brief Returns the first edge of a node
+    */
+    const Edge* edges_begin(const NodeId& node) const
+    {
+        return edges + offsets[node];
+
+    } // edges_begin
+
+    /**
+      @brief Returns the end of the edges of a node
+    */
+    const Edge* edges_end(const NodeId& node) const
+    {
+        return edges + offsets[node + 1];
+
+    } // edges_end
+
+    /**
+      @brief Tests whether a word is in the corpus
+      @param word, a Word
+      @return true iff the word was indexed
+    */
+    bool contains(const Word& word) const
+    {
+        NodeId node = root();
+        for (auto c: word) {
+            const Edge* last = edges_end(node);
+            const Edge* pos = lower_edge(node, static_cast<unsigned char>(c));
+            if (pos == last || pos->symbol != static_cast<unsigned char>(c)) { return false; }
+            node = pos->target;
+        }
+
+        return is_final(node);
+
+    } // contains
+
+    /**
+      @brief Returns the first word in the corpus that is lexicographically greater than or equal to the input word
+      @param input, a Word
+      @param result, receives the found word
+      @return true iff there is such a word
+    */
+    bool next_in_corpus(const Word& input, Word& result) const
+    {
+        // Follow the input as far as possible, path[i] is the node after i characters
+        std::vector<NodeId> path(1, root());
+        while (path.size() <= input.size()) {
+            unsigned char c = input[path.size() - 1];
+            const Edge* pos = lower_edge(path.back(), c);
+            if (pos == edges_end(path.back()) || pos->symbol != c) { break; }
+            path.push_back(pos->target);
+        }
+
+        std::size_t depth = path.size() - 1;
+        if (depth == input.size() && is_final(path.back()) == true) {
+            result = input;
+            return true;
+        }
+
+        // Leave the path at the deepest node that has an edge larger than the input,
+        // at the end of the input every edge is larger
+        int first = (depth == input.size()) ? 0 : static_cast<unsigned char>(input[depth]) + 1;
+        const Edge* pos = lower_edge(path.back(), first);
+        while (pos == edges_end(path.back())) {
+            if (depth == 0) { return false; }
+
+            path.pop_back();
+            depth--;
+            pos = lower_edge(path.back(), static_cast<unsigned char>(input[depth]) + 1);
+        }
+
+        result.assign(input, 0, depth);
+        result.push_back(static_cast<char>(pos->symbol));
+
+        // Every node lies on the path of some word, so following the first edges reaches the smallest one
+        NodeId node = pos->target;
+        while (is_final(node) == false) {
+            result.push_back(static_cast<char>(edges_begin(node)->symbol));
+            node = edges_begin(node)->target;
+        }
+
+        return true;
+
+    } // next_in_corpus
+
+    /**
+      @brief Number of distinct words in the index
+    */
+    std::size_t size() const
+    {
+        return words;
+
+    } // size
+
+    /**
+      @brief Number of nodes of the minimal automaton
+    */
+    std::size_t node_count() const
+    {
+        return nodes;
+
+    } // node_count
+
+
+   private: // Functions
+    /**
+      @brief Checks the arrays of a loaded index before any lookup follows them
+             The offsets have to ascend from 0 to the number of edges, the edges of a node have to be sorted
+             and lead to a node, every node but the root has to end a word or have an edge, and no path may
+             run in a cycle; otherwise a lookup could read outside the file or never end
+             The paths from the root to a final node have to be as many as the header's number of words
+      @param edge_count, the number of edges the header announces
+      @param word_count, the number of words the header announces
+      @return true iff the index is well-formed
+    */
+    bool check(const std::uint64_t& edge_count, const std::uint64_t& word_count) const
+    {
+        if (offsets[0] != 0 || offsets[nodes] != edge_count) { return false; }
+
+        std::vector<std::uint32_t> incoming(nodes, 0);
+        for (NodeId n = 0; n < nodes; n++) {
+            if (offsets[n + 1] < offsets[n] || offsets[n + 1] > edge_count) { return false; }
+            if (n != root() && offsets[n + 1] == offsets[n] && is_final(n) == false) { return false; }
+
+            for (std::uint32_t e = offsets[n]; e < offsets[n + 1]; e++) {
+                if (edges[e].target >= nodes) { return false; }
+                if (e > offsets[n] && edges[e].symbol <= edges[e - 1].symbol) { return false; }
+                incoming[edges[e].target]++;
+            }
+        }
+
+        // Remove the nodes without incoming edges until none are left, a cycle keeps its nodes
+        std::vector<NodeId> ready;
+        for (NodeId n = 0; n < nodes; n++) {
+            if (incoming[n] == 0) { ready.push_back(n); }
+        }
+        std::vector<NodeId> order;
+        order.reserve(nodes);
+        while (ready.empty() == false) {
+            NodeId n = ready.back();
+            ready.pop_back();
+            order.push_back(n);
+            for (const Edge* e = edges_begin(n); e != edges_end(n); e++) {
+                if (--incoming[e->target] == 0) { ready.push_back(e->target); }
+            }
+        }
+        if (order.size() != nodes) { return false; }
+
+        // Count the words below every node, children before parents; the counts stop at one more than word_count
+        const std::uint64_t cap = std::max(word_count, word_count + 1);
+        std::vector<std::uint64_t> paths(nodes, 0);
+        for (std::size_t i = order.size(); i-- > 0; ) {
+            NodeId n = order[i];
+            std::uint64_t count = is_final(n) == true ? 1 : 0;
+            for (const Edge* e = edges_begin(n); e != edges_end(n); e++) {
+                count += std::min(paths[e->target], cap - count);
+            }
+            paths[n] = count;
+        }
+
+        return paths[root()] == word_count;
+
+    } // check
+
+    /**
+      @brief Finds the first edge of a node whose symbol is not smaller than a given one
+    */
+    const Edge* lower_edge(const NodeId& node, const int& symbol) const
+    {
+        return std::lower_bound(edges_begin(node), edges_end(node), symbol,
+                                [](const Edge& edge, const int& s) { return edge.symbol < s; });
+
+    } // lower_edge
+
+    /**
+      @brief The first bytes of every index file, the last one is the format version
+    */
+    static const char* magic()
+    {
+        return "LEVDAWG1";
+
+    } // magic
+
+    /**
+      @brief Rounds a number of bytes up to a multiple of 8
+    */
+    static std::uint64_t aligned(const std::uint64_t& bytes)
+    {
+        return (bytes + 7) / 8 * 8;
+
+    } // aligned
+
+    /**
+      @brief Builds the minimal automaton incrementally from the sorted corpus
+             (Daciuk et al., incremental construction from sorted data)
+      @param corpus, the sorted words
+    */
+    void build(const WordVec& corpus)
+    {
+        words = 0;
+        std::vector<BuildNode> nodes(1);
+        nodes[0].final = false;
+        std::map<Signature, NodeId> registry;
+
+        const Word* previous = 0;
+        for (auto& word: corpus) {
+            if (previous != 0 && *previous == word) { continue; }
+
+            // Follow the prefix the word shares with the previous one
+            std::size_t common = 0;
+            NodeId node = 0;
+            if (previous != 0) {
+                while (common < word.size() && common < previous->size() && word[common] == (*previous)[common]) {
+                    node = nodes[node].children.back().second;
+                    common++;
+                }
+            }
+
+            // Everything behind this prefix is complete now and can be merged with equivalent nodes
+            if (nodes[node].children.empty() == false) {
+                replace_or_register(nodes, registry, node);
+            }
+
+            for (std::size_t i = common; i < word.size(); i++) {
+                BuildNode child;
+                child.final = false;
+                nodes.push_back(child);
+                nodes[node].children.push_back(std::make_pair(static_cast<unsigned char>(word[i]), NodeId(nodes.size() - 1)));
+                node = nodes.size() - 1;
+            }
+            nodes[node].final = true;
+
+            previous = &word;
+            words++;
+        } // for corpus
+
+        if (nodes[0].children.empty() == false) {
+            replace_or_register(nodes, registry, 0);
+        }
+        freeze(nodes);
+
+    } // build
+
+    /**
+      @brief Replaces the last child of a node by an equivalent registered node, or registers it
+      @param nodes, all nodes built so far
+      @param registry, the registered nodes by signature
+      @param node, the node whose last child is complete
+    */
+    static void replace_or_register(std::vector<BuildNode>& nodes, std::map<Signature, NodeId>& registry, const NodeId& node)
+    {
+        NodeId child = nodes[node].children.back().second;
+        if (nodes[child].children.empty() == false) {
+            replace_or_register(nodes, registry, child);
+        }
+
+        Signature signature;
+        signature.push_back(nodes[child].final ? 1 : 0);
+        for (auto& c: nodes[child].children) {
+            signature.push_back(c.first);
+            signature.push_back(c.second);
+        }
+
+        auto pos = registry.find(signature);
+        if (pos != registry.end()) {
+            // The child is not referenced anymore, its slot just stays unused
+            nodes[node].children.back().second = pos->second;
+            nodes[child].children.clear();
+        }
+        else {
+            registry[signature] = child;
+        }
+
+    } // replace_or_register
+
+    /**
+      @brief Stores all nodes reachable from the root in the flat arrays, numbered in visiting order
+      @param nodes, the built nodes
+    */
+    void freeze(const std::vector<BuildNode>& nodes)
+    {
+        const NodeId UNSEEN = 0xFFFFFFFF;
+        std::vector<NodeId> ids(nodes.size(), UNSEEN);
+        std::vector<NodeId> order;
+
+        ids[0] = 0;
+        order.push_back(0);
+        for (std::size_t i = 0; i < order.size(); i++) {
+            for (auto& c: nodes[order[i]].children) {
+                if (ids[c.second] == UNSEEN) {
+                    ids[c.second] = order.size();
+                    order.push_back(c.second);
+                }
+            }
+        }
+
+        offset_storage.assign(1, 0);
+        final_storage.assign((order.size() + 63) / 64, 0);
+        for (std::size_t i = 0; i < order.size(); i++) {
+            const BuildNode& node = nodes[order[i]];
+            for (auto& c: node.children) {
+                Edge edge = {c.first, ids[c.second]};
+                edge_storage.push_back(edge);
+            }
+            offset_storage.push_back(edge_storage.size());
+
+            if (node.final == true) { final_storage[i / 64] |= std::uint64_t(1) << (i % 64); }
+        }
+
+        this->nodes = order.size();
+        offsets = offset_storage.data();
+        edges = edge_storage.data();
+        finals = final_storage.data();
+
+    } // freeze
+
+
+   private: // variables
+      const std::uint32_t*          offsets;        ///< the edges of node n are edges[offsets[n] .. offsets[n+1])
+      const Edge*                   edges;          ///< all edges, grouped by node and sorted by symbol
+      const std::uint64_t*          finals;         ///< bitset of the nodes that end a word
+      std::size_t                   nodes;          ///< the number of nodes
+      std::size_t                   words;          ///< the number of indexed words
+
+      std::vector<std::uint32_t>    offset_storage; ///< the arrays of an index built in memory
+      std::vector<Edge>             edge_storage;
+      std::vector<std::uint64_t>    final_storage;
+      std::shared_ptr<const void>   storage;        ///< or whatever keeps the memory of a loaded index alive
+
+  }; // CorpusIndex
+
+#endif // CORPUSINDEX_HPP_INCLUDED
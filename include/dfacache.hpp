@@ -0,0 +1,154 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Cache of compiled automata shared by all lookups
+*/
+
+#ifndef DFACACHE_HPP_INCLUDED
+#define DFACACHE_HPP_INCLUDED
+
+#define DFA_CACHE_SIZE 1024
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include "compileddfa.hpp"
+#include "editcosts.hpp"
+
+/**
+  @brief DFACache keeps the CompiledDFAs of recent lookups, so a repeated lookup word skips building the NFA
+         and the subset construction entirely
+         An automaton only depends on the lookup word, k and the edit costs, which together are the key
+         At most a fixed number of automata are kept, the least recently used one is dropped first
+         All functions may be called by any number of threads; an automaton is built outside the lock,
+         so two threads missing the same key at once both build it and the first one is kept
+*/
+class DFACache
+  {
+   public: // Types
+      typedef std::shared_ptr<const CompiledDFA>    DFAPtr;
+
+      /// What the cache has done so far
+      struct Statistics
+      {
+          unsigned long long    hits;       ///< lookups answered from the cache
+          unsigned long long    misses;     ///< lookups that had to build the automaton
+          unsigned long long    evictions;  ///< automata dropped to make room
+          std::size_t           size;       ///< automata in the cache now
+      };
+
+   private: // Types
+      typedef std::string                       Word;
+      typedef std::tuple<Word, unsigned, unsigned, unsigned, unsigned, unsigned, bool>  Key;
+      typedef std::list<std::pair<Key, DFAPtr>>  EntryList;
+
+
+   public: // Functions
+    /**
+      @brief Constructor
+      @param size, the largest number of automata kept
+    */
+    explicit DFACache(const std::size_t& size = DFA_CACHE_SIZE)
+    {
+        capacity = std::max<std::size_t>(size, 1);
+        hits = 0;
+        misses = 0;
+        evictions = 0;
+    }
+
+    /// The cache is shared through a pointer
+    DFACache(const DFACache&) = delete;
+    DFACache& operator=(const DFACache&) = delete;
+
+    /**
+      @brief Returns the automaton for a lookup, building and adding it if it is not cached
+      @param word, the lookup word
+      @param k, the maximum edit distance
+      @param costs, the edit costs
+      @param build, is called without arguments to build the automaton on a miss
+      @return The automaton
+    */
+    template<class Build>
+    DFAPtr get(const Word& word, const unsigned& k, const EditCosts& costs, Build build)
+    {
+        Key key(word, k, costs.insertion, costs.deletion, costs.substitution, costs.transposition, costs.utf8);
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            auto pos = index.find(key);
+            if (pos != index.end()) {
+                hits++;
+                entries.splice(entries.begin(), entries, pos->second);
+                return pos->second->second;
+            }
+            misses++;
+        }
+
+        DFAPtr dfa = std::make_shared<const CompiledDFA>(build());
+
+        std::lock_guard<std::mutex> guard(lock);
+        auto pos = index.find(key);
+        if (pos != index.end()) {
+            // Another thread was faster, share its automaton
+            entries.splice(entries.begin(), entries, pos->second);
+            return pos->second->second;
+        }
+
+        entries.push_front(std::make_pair(key, dfa));
+        index[key] = entries.begin();
+        if (entries.size() > capacity) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+            evictions++;
+        }
+
+        return dfa;
+
+    } // get
+
+    /**
+      @brief Returns the counters of the cache
+    */
+    Statistics statistics() const
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Statistics s = {hits, misses, evictions, entries.size()};
+        return s;
+
+    } // statistics
+
+    /**
+      @brief Drops all automata, the counters are kept
+    */
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        index.clear();
+        entries.clear();
+
+    } // clear
+
+
+   private: // variables
+      std::size_t                               capacity;   ///< the largest number of automata kept
+      EntryList                                 entries;    ///< the automata, most recently used first
+      std::map<Key, EntryList::iterator>        index;      ///< the entries by their key
+      unsigned long long                        hits;       ///< see Statistics
+      unsigned long long                        misses;     ///< see Statistics
+      unsigned long long                        evictions;  ///< see Statistics
+      mutable std::mutex                        lock;       ///< guards all of the above
+
+  }; // DFACache
+
+typedef std::shared_ptr<DFACache>   DFACachePtr;    ///< the handle a DFACache is shared with
+
+#endif // DFACACHE_HPP_INCLUDED
@@ -10,13 +10,14 @@ Compact representation of a deterministic final automaton
 #ifndef DFAUTOMATON_HPP_INCLUDED
 #define DFAUTOMATON_HPP_INCLUDED
 
-#define ANY       "ANY"
-#define EPSILON   "EPSILON"
 #define NONE      "\0"
-#define NUL       "-"
+#define NUL       '\0'
 
 #include <iostream>
 
+#include "label.hpp"
+#include "levstats.hpp"
+
 /**
   @brief DFAutomaton is a class for representing
          standard deterministic final automata
@@ -31,7 +32,7 @@ class DFAutomaton
    private: // Types
       typedef std::string                       Word;
       typedef std::vector<Word>                 WordVec;
-      typedef std::map<Word, DState>            WordStateMap;
+      typedef std::map<Label, DState>           LabelStateMap;
 
 
    public: // Functions
@@ -63,10 +64,10 @@ class DFAutomaton
     /**
       @brief Adds a transition from one state to another with a certain input
       @param src, the first DState
-      @param input, the Word label
+      @param input, the Label
       @param dest, the reached DState
     */
-    void add_transition(const DState& src, const Word& input, const DState& dest)
+    void add_transition(const DState& src, const Label& input, const DState& dest)
     {
         for (auto s: dest) {
             transitions[src][input].insert(s);
@@ -109,20 +110,24 @@ class DFAutomaton
     } // is_final
 
     /**
-      @brief Looks for the next reachable state from a given state and an input word
+      @brief Looks for the next reachable state from a given state and an input label
       @param src, a DState
-      @param input, a Word
+      @param input, a Label
       @return The state reachable from this state and input
     */
-    DState next_state(const DState& src, const Word& input)
+    DState next_state(const DState& src, const Label& input) const
     {
         // If the given input is valid for this state, all reachable states from the map of transitions are returned
-        if (transitions[src].count(input) == 1) {  return transitions[src][input];   }
+        // Lookups never insert into the maps, so a finished automaton can be read by many threads at once
+        auto trans = transitions.find(src);
+        if (trans != transitions.end()) {
+            auto dest = trans->second.find(input);
+            if (dest != trans->second.end()) { return dest->second; }
+        }
 
         // Else if this state can be found in the default transitions, all reachable states from the map of defaults are returned
-        else {
-            if (defaults.count(src) == 1) { return defaults[src];  }
-        }
+        auto def = defaults.find(src);
+        if (def != defaults.end()) { return def->second; }
 
         return NOSTATE;
 
@@ -133,18 +138,20 @@ class DFAutomaton
       @param input, a Word
       @return The next valid Word from this one
     */
-    Word next_valid(const Word& input)
+    Word next_valid(const Word& input) const
     {
+        LEV_COUNT(next_valid, 1);
         DState state = startState;
-        std::deque<std::tuple<Word, DState, Word>> current_tuples;
+        // Each tuple holds a path, the state it leads to and the last symbol tried from there (-1 for none)
+        std::deque<std::tuple<Word, DState, int>> current_tuples;
         bool looper = true;
 
         int i = 0;
         for (; i < input.size(); i++) {
-            // Word x is the letter at the current position in the input
-            Word x(1, input[i]);
+            // x is the letter at the current position in the input
+            Label x = Label::byte(input[i]);
             // Create and add a new tuple with the first part of the input, the current state and x
-            current_tuples.push_back(std::make_tuple(input.substr(0,i), state, x));
+            current_tuples.push_back(std::make_tuple(input.substr(0,i), state, static_cast<int>(x.value())));
 
             state = next_state(state, x);
 
@@ -157,7 +164,7 @@ class DFAutomaton
         } // for
         // If the loop was not stopped by the NOSTATE condition, another tuple is created and added
         if (looper == true) {
-            current_tuples.push_back(std::make_tuple(input.substr(0,i+1), state, NONE));
+            current_tuples.push_back(std::make_tuple(input.substr(0,i+1), state, -1));
         }
 
         // If the recently found state is final, the given input was already valid and can be returned
@@ -169,24 +176,27 @@ class DFAutomaton
             // Retrieve the elements from the last tuple in the queue and pop this tuple
             Word path = std::get<0>(current_tuples.back());
             state = std::get<1>(current_tuples.back());
-            Word x = std::get<2>(current_tuples.back());
+            int x = std::get<2>(current_tuples.back());
             current_tuples.pop_back();
 
             x = find_next_edge(state, x);
 
-            // If there is a valid next edge from the current state with Word x,
+            // If there is a valid next edge from the current state with symbol x,
             // then the current path is extended by x
-            if (x != NONE) {
-                path += x;
-                state = next_state(state, x);
+            if (x >= 0) {
+                path += static_cast<char>(x);
+                state = next_state(state, Label::symbol(x));
 
-                // If the next reachable state with the current state and Word x is final, the path is valid and can be returned
+                // If the next reachable state with the current state and symbol x is final, the path is valid and can be returned
                 if (is_final(state) == true) {
                     return path;
                 }
 
-                current_tuples.push_back(std::make_tuple(path, state, NONE));
+                current_tuples.push_back(std::make_tuple(path, state, -1));
             } // if x
+            else {
+                LEV_COUNT(backtracks, 1);
+            }
 
         } // while
 
@@ -195,45 +205,34 @@ class DFAutomaton
     } // next_valid
 
     /**
-      @brief Retrieves the next valid edge given a DState and an input Word
+      @brief Retrieves the next valid edge given a DState and the last symbol tried
       @param state, a DState
-      @param Word x
-      @return The next valid edge (Word)
+      @param x, the last symbol tried from this state, -1 if there was none
+      @return The symbol of the next valid edge, -1 if there is none
     */
-    Word find_next_edge(DState state, Word x)
+    int find_next_edge(const DState& state, const int& x) const
     {
-        if (x == NONE) {
-            x = NUL;
-       }
-        else {
-            // x will be one single character; now retrieve the next ascii char and transform x back
-            int i = *(x.c_str());
-            Word next(1, i+1);
-            x = next;
-       }
-
-       if (transitions.find(state) != transitions.end()) {
-           // If x is a valid input for the given state or if this state is among the default transitions, then x is valid and can be returned
-           if (transitions[state].find(x) != transitions[state].end() || defaults.find(state) != defaults.end()) {
-                return x;
-            }
+        // The candidate is the symbol following x, or the smallest one of all
+        int next = (x < 0) ? NUL : x + 1;
+        if (next > 255) {
+            return -1;
+        }
 
-            // Get all valid inputs for the current state and sort them alphabetically
-            WordVec inputs;
-            for (auto iter = transitions[state].begin(); iter != transitions[state].end(); iter++) {
-                inputs.push_back(iter->first);
-            }
-            std::sort(inputs.begin(), inputs.end());
+        // If this state is among the default transitions, every symbol is valid
+        if (defaults.find(state) != defaults.end()) {
+            return next;
+        }
 
-            // Now find the leftmost position where x fits between these inputs and return the Word at this position
-            auto pos = std::lower_bound(inputs.begin(), inputs.end(), x);
-            if (pos != inputs.end()) {
-                return *pos;
+        auto trans = transitions.find(state);
+        if (trans != transitions.end()) {
+            // The labels are sorted with all symbols in front, so the first one from the candidate on is the next edge
+            auto pos = trans->second.lower_bound(Label::symbol(next));
+            if (pos != trans->second.end() && pos->first.kind() == Label::SYMBOL) {
+                return pos->first.value();
             }
+        }
 
-       }
-
-        return NONE;
+        return -1;
 
     } // find_next_edge
 
@@ -320,7 +319,7 @@ class DFAutomaton
 
    private: // variables
       DState                            startState;     ///< the automaton's start state
-      std::map<DState, WordStateMap>    transitions;    ///< the map containing all transitions of the automaton
+      std::map<DState, LabelStateMap>   transitions;    ///< the map containing all transitions of the automaton
       std::set<DState>                  final_states;   ///< the set of final states
       std::map<DState, DState>          defaults;       ///< the map for storing all default transitions
       DState                            NOSTATE;        ///< default for invalid or nonexisting states
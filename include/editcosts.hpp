@@ -0,0 +1,84 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Costs of the edit operations a Levenshtein automaton allows
+*/
+
+#ifndef EDITCOSTS_HPP_INCLUDED
+#define EDITCOSTS_HPP_INCLUDED
+
+/**
+  @brief EditCosts tells what every edit operation adds to the distance between the lookup word and an input
+         With all costs 1 and no transposition this is the Levenshtein distance,
+         with a transposition cost of 1 the (restricted) Damerau-Levenshtein distance,
+         where swapping two adjacent bytes is one typing error instead of two
+         With utf8 set, the operations apply to the codepoints of UTF-8 encoded words instead of their bytes
+         A LevenshteinAutomaton counts an insertion, deletion or substitution cost of 0 as 1, see clamped()
+*/
+struct EditCosts
+  {
+      unsigned      insertion;      ///< a byte of the lookup word is missing in the input, at least 1
+      unsigned      deletion;       ///< the input has a byte the lookup word has not, at least 1
+      unsigned      substitution;   ///< a byte of the lookup word is replaced by another one, at least 1
+      unsigned      transposition;  ///< two adjacent bytes of the lookup word are swapped, 0 if not allowed
+      bool          utf8;           ///< whether a symbol is a codepoint rather than a byte
+
+    /**
+      @brief The costs of the Levenshtein distance
+    */
+    static EditCosts levenshtein()
+    {
+        EditCosts costs = {1, 1, 1, 0, false};
+        return costs;
+
+    } // levenshtein
+
+    /**
+      @brief The costs of the restricted Damerau-Levenshtein distance
+    */
+    static EditCosts damerau()
+    {
+        EditCosts costs = {1, 1, 1, 1, false};
+        return costs;
+
+    } // damerau
+
+    /**
+      @brief The same costs for every codepoint of UTF-8 encoded words, so that an umlaut is one edit and not two
+    */
+    EditCosts over_utf8() const
+    {
+        EditCosts costs = *this;
+        costs.utf8 = true;
+        return costs;
+
+    } // over_utf8
+
+    /**
+      @brief The same costs with insertion, deletion and substitution raised to at least 1
+             An edit for free would let the automaton accept words of any length, and a search would never end
+    */
+    EditCosts clamped() const
+    {
+        EditCosts costs = *this;
+        if (costs.insertion == 0) { costs.insertion = 1; }
+        if (costs.deletion == 0) { costs.deletion = 1; }
+        if (costs.substitution == 0) { costs.substitution = 1; }
+        return costs;
+
+    } // clamped
+
+    bool operator==(const EditCosts& other) const
+    {
+        return insertion == other.insertion && deletion == other.deletion
+            && substitution == other.substitution && transposition == other.transposition && utf8 == other.utf8;
+    }
+
+    bool operator!=(const EditCosts& other) const { return !(*this == other); }
+
+  }; // EditCosts
+
+#endif // EDITCOSTS_HPP_INCLUDED
@@ -0,0 +1,127 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Typed edge labels for the automata
+*/
+
+#ifndef LABEL_HPP_INCLUDED
+#define LABEL_HPP_INCLUDED
+
+#include <cstdint>
+#include <iostream>
+
+/**
+  @brief Label is the label of an edge in an NFAutomaton or DFAutomaton
+         It is either a symbol (a byte or a codepoint), the ANY wildcard or EPSILON
+         Labels are plain integers, so comparing them never touches a string;
+         symbols sort by their value and before ANY and EPSILON
+*/
+class Label
+  {
+   public: // Types
+      /// What kind of edge a label stands for
+      enum Kind
+      {
+          SYMBOL  = 0,  ///< a single input symbol
+          ANY     = 1,  ///< any single input symbol, a default edge in a DFA
+          EPSILON = 2   ///< no input at all
+      };
+
+
+   public: // Functions
+    /**
+      @brief Creates the label of a symbol
+      @param c, a byte or a codepoint
+    */
+    static Label symbol(const std::uint32_t& c)
+    {
+        return Label(SYMBOL, c);
+
+    } // symbol
+
+    /**
+      @brief Creates the label of a byte given as a char
+      @param c, a character of a Word
+    */
+    static Label byte(const char& c)
+    {
+        return Label(SYMBOL, static_cast<unsigned char>(c));
+
+    } // byte
+
+    /**
+      @brief Creates the ANY label
+    */
+    static Label any()
+    {
+        return Label(ANY, 0);
+
+    } // any
+
+    /**
+      @brief Creates the EPSILON label
+    */
+    static Label epsilon()
+    {
+        return Label(EPSILON, 0);
+
+    } // epsilon
+
+    /**
+      @brief Returns the kind of this label
+    */
+    Kind kind() const
+    {
+        return static_cast<Kind>(code >> 24);
+
+    } // kind
+
+    /**
+      @brief Returns the symbol of a SYMBOL label
+    */
+    std::uint32_t value() const
+    {
+        return code & 0xFFFFFF;
+
+    } // value
+
+    bool operator<(const Label& other) const  { return code < other.code;  }
+    bool operator==(const Label& other) const { return code == other.code; }
+    bool operator!=(const Label& other) const { return code != other.code; }
+
+    /**
+      @brief Writes a readable representation of a label to stream 'out'
+    */
+    friend std::ostream& operator<<(std::ostream& out, const Label& label)
+    {
+        switch (label.kind()) {
+            case ANY:       return out << "ANY";
+            case EPSILON:   return out << "EPSILON";
+            default:        break;
+        }
+
+        if (label.value() < 0x80) { return out << static_cast<char>(label.value()); }
+        return out << "#" << label.value();
+
+    } // operator<<
+
+
+   private: // Functions
+    /**
+      @brief Constructor from kind and symbol
+    */
+    Label(const Kind& kind, const std::uint32_t& c)
+    {
+        code = (static_cast<std::uint32_t>(kind) << 24) | (c & 0xFFFFFF);
+    }
+
+
+   private: // variables
+      std::uint32_t     code;   ///< the kind in the upper byte and the symbol below
+
+  }; // Label
+
+#endif // LABEL_HPP_INCLUDED
@@ -0,0 +1,307 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Deterministic automaton that is determinized from an NFA on demand
+*/
+
+#ifndef LAZYDFA_HPP_INCLUDED
+#define LAZYDFA_HPP_INCLUDED
+
+#define NONE      "\0"
+#define NUL       '\0'
+
+#ifndef MAX_LAZY_STATES
+#define MAX_LAZY_STATES 4096
+#endif
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nextvalid.hpp"
+#include "nfautomaton.hpp"
+
+/**
+  @brief LazyDFA does the subset construction of an NFAutomaton step by step while it is traversed
+         A state is built the first time a transition leads to it, and a transition is computed
+         the first time it is taken, so a search that visits a small part of the automaton never pays for the rest
+         The built states are kept in a cache of bounded size; once it is full, the least recently used state
+         is dropped and built again if it is needed later
+         States handed out stay valid while they are held, even if they are dropped from the cache
+         The cache is changed by const functions, so a LazyDFA must be used by one thread only
+*/
+class LazyDFA
+  {
+   private: // Types
+      typedef std::string                       Word;
+      typedef NFAutomaton::Stateset             Stateset;
+
+      struct Node;
+      typedef std::list<Node*>                  NodeList;
+
+      /// A state of the DFA: its set of NFA states, what is known about it, and its transitions so far
+      struct Node
+      {
+          Stateset                          states;
+          bool                              final;
+          unsigned                          distance;   ///< the edit distance if the state is final
+          unsigned                          bound;      ///< the smallest distance reachable from the state
+          std::vector<unsigned char>        symbols;    ///< the bytes with their own transitions, sorted
+          bool                              fallback;   ///< whether all other bytes have a transition
+          std::vector<std::weak_ptr<Node>>  targets;    ///< the target for every symbol, the last one for all others;
+                                                        ///< the dead marker if it is the empty set, expired if not known
+          bool                              cached;     ///< whether the node is still in the cache
+          NodeList::iterator                position;   ///< its place in the cache's list of recent use
+      };
+
+   public: // Types
+      typedef std::shared_ptr<Node>             State;  ///< an empty pointer is the dead state
+
+
+   public: // Functions
+    /**
+      @brief Default constructor, creates an automaton that accepts nothing
+    */
+    LazyDFA()
+    {
+        capacity = MAX_LAZY_STATES;
+        dead = std::make_shared<Node>();
+    }
+
+    /**
+      @brief Constructor from an NFA
+      @param automaton, the NFA, which is shared and must not change any more
+      @param states, the largest number of states kept in the cache
+    */
+    LazyDFA(const std::shared_ptr<const NFAutomaton>& automaton, const std::size_t& states = MAX_LAZY_STATES)
+    {
+        nfa = automaton;
+        capacity = std::max<std::size_t>(states, 1);
+        dead = std::make_shared<Node>();
+        first = materialize(nfa->start_states());
+    }
+
+    /// A copy shares the NFA but starts with an empty cache, the nodes of the original are not shared
+    LazyDFA(const LazyDFA& other)
+    {
+        nfa = other.nfa;
+        capacity = other.capacity;
+        dead = std::make_shared<Node>();
+        if (other.first != nullptr) { first = materialize(nfa->start_states()); }
+    }
+
+    /// States still held from before are no longer in the cache, but stay valid
+    LazyDFA& operator=(const LazyDFA& other)
+    {
+        if (this != &other) {
+            for (auto node: recent) {
+                node->cached = false;
+            }
+            cache.clear();
+            recent.clear();
+            nfa = other.nfa;
+            capacity = other.capacity;
+            first.reset();
+            if (other.first != nullptr) { first = materialize(nfa->start_states()); }
+        }
+        return *this;
+    }
+
+    /**
+      @brief Returns the start state, which is kept for the lifetime of the automaton
+    */
+    State start() const
+    {
+        return first;
+
+    } // start
+
+    /**
+      @brief Number of states in the cache
+    */
+    std::size_t size() const
+    {
+        return cache.size();
+
+    } // size
+
+    /**
+      @brief Tests whether a state is the dead state
+      @param state, a State
+    */
+    bool is_dead(const State& state) const
+    {
+        return state == nullptr;
+
+    } // is_dead
+
+    /**
+      @brief Tests whether a state is final
+      @param state, a State that is not dead
+    */
+    bool is_final(const State& state) const
+    {
+        return state->final;
+
+    } // is_final
+
+    /**
+      @brief Returns the edit distance a final state stands for
+      @param state, a final State
+    */
+    unsigned distance(const State& state) const
+    {
+        return state->distance;
+
+    } // distance
+
+    /**
+      @brief Returns a lower bound of the distance of every final state reachable from a state
+      @param state, a State that is not dead
+    */
+    unsigned min_distance(const State& state) const
+    {
+        return state->bound;
+
+    } // min_distance
+
+    /**
+      @brief Looks for the next reachable state from a given state and an input byte,
+             determinizing it if the transition is taken for the first time or its target was dropped
+      @param src, a State
+      @param symbol, the input byte
+      @return The state reachable from this state and input, or the dead state
+    */
+    State next_state(const State& src, const unsigned char& symbol) const
+    {
+        if (src == nullptr) { return nullptr; }
+
+        Node& node = *src;
+        std::size_t slot = node.symbols.size();
+        auto pos = std::lower_bound(node.symbols.begin(), node.symbols.end(), symbol);
+        if (pos != node.symbols.end() && *pos == symbol) {
+            slot = pos - node.symbols.begin();
+        }
+        else if (node.fallback == false) {
+            return nullptr;
+        }
+
+        State dest = node.targets[slot].lock();
+        if (dest == dead) { return nullptr; }
+
+        if (dest == nullptr) {
+            Label input = slot < node.symbols.size() ? Label::byte(symbol) : Label::any();
+            dest = materialize(nfa->next_states(node.states, input));
+
+            // The empty set is remembered as well, so it is not computed again
+            node.targets[slot] = dest != nullptr ? dest : dead;
+        }
+        else if (dest->cached == true) {
+            recent.splice(recent.begin(), recent, dest->position);
+        }
+
+        return dest;
+
+    } // next_state
+
+    /**
+      @brief Retrieves the smallest valid edge of a state starting at a given symbol
+      @param state, a State
+      @param first, the smallest symbol to be considered
+      @return The symbol of the next valid edge, or -1 if there is none
+    */
+    int find_next_edge(const State& state, const int& first) const
+    {
+        if (first > 255) { return -1; }
+
+        // With a transition for all other bytes every symbol is valid, unless it is known to lead nowhere
+        if (state->fallback == true && state->targets.back().lock() != dead) { return first; }
+
+        auto pos = std::lower_bound(state->symbols.begin(), state->symbols.end(), first);
+        if (pos != state->symbols.end()) { return *pos; }
+
+        return -1;
+
+    } // find_next_edge
+
+    /**
+      @brief Searches the automaton for the next valid Word given an input Word
+             The buffers keep the path of the previous call, which is only walked back to where the input leaves it
+      @param input, a Word
+      @param result, the previous result or empty, receives the next valid Word from this one
+      @param stack, the states along the previous result or empty, receives the states along the new one
+      @return true iff there is a next valid Word
+    */
+    bool next_valid(const Word& input, Word& result, std::vector<State>& stack) const
+    {
+        return ::next_valid(*this, input, result, stack);
+
+    } // next_valid
+
+
+   private: // Functions
+    /**
+      @brief Returns the node of a set of NFA states, from the cache or newly built
+      @param states, the set of NFA states, expanded
+      @return The node, or the dead state for the empty set
+    */
+    State materialize(const Stateset& states) const
+    {
+        if (states.empty() == true) { return nullptr; }
+
+        auto pos = cache.find(states);
+        if (pos != cache.end()) {
+            recent.splice(recent.begin(), recent, pos->second->position);
+            return pos->second;
+        }
+
+        LEV_COUNT(dfa_states, 1);
+        State node = std::make_shared<Node>();
+        node->states = states;
+        node->final = nfa->contains_final_states(states);
+        nfa->count_errors(states, node->distance, node->bound);
+        node->fallback = false;
+
+        for (auto input: nfa->get_inputs(states)) {
+            if (input.kind() == Label::SYMBOL) { node->symbols.push_back(input.value()); }
+            if (input.kind() == Label::ANY) { node->fallback = true; }
+        }
+        std::sort(node->symbols.begin(), node->symbols.end());
+        node->symbols.erase(std::unique(node->symbols.begin(), node->symbols.end()), node->symbols.end());
+        node->targets.resize(node->symbols.size() + 1);
+
+        recent.push_front(node.get());
+        node->position = recent.begin();
+        node->cached = true;
+        cache[states] = node;
+
+        // Drop the least recently used state; whoever still holds it keeps it alive
+        if (cache.size() > capacity) {
+            Node* oldest = recent.back();
+            recent.pop_back();
+            oldest->cached = false;
+            cache.erase(cache.find(oldest->states));
+        }
+
+        return node;
+
+    } // materialize
+
+
+   private: // variables
+      std::shared_ptr<const NFAutomaton>    nfa;        ///< the automaton that is determinized
+      std::size_t                           capacity;   ///< the largest number of cached states
+      State                                 first;      ///< the start state
+      State                                 dead;       ///< marks the transitions into the empty set, never handed out
+      mutable std::map<Stateset, State>     cache;      ///< the built states by their sets of NFA states
+      mutable NodeList                      recent;     ///< the cached states, most recently used first
+
+  }; // LazyDFA
+
+#endif // LAZYDFA_HPP_INCLUDED
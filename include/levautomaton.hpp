@@ -11,30 +11,64 @@ Or can be used for "Did you mean"-purposes
 
 #include "dfautomaton.hpp"
 #include "nfautomaton.hpp"
+#include "paramautomaton.hpp"
+#include "bitparallel.hpp"
+#include "lazydfa.hpp"
+#include "corpus.hpp"
+#include "dfacache.hpp"
+#include "editcosts.hpp"
+#include "levstats.hpp"
+#include "workstealingpool.hpp"
 
 #ifndef LEVAUTOMATON_H_INCLUDED
 #define LEVAUTOMATON_H_INCLUDED
 
-#define ANY       "ANY"
-#define EPSILON   "EPSILON"
 #define NONE      "\0"
-#define NUL       "-"
+#define NUL       '\0'
 
-/**
+// Optional reduction of the CompiledDFA, see CompiledDFA::minimize
+#ifndef LEV_MINIMIZE_DFA
+#define LEV_MINIMIZE_DFA 0
+#endif
+
+/**
   @brief LevenshteinAutomaton is a class for representing
          Levenshtein automata
          They depict all words in Levenshtein distance k to a given word
-         Can also be used for a "Did you mean" function
+         Can also be used for a "Did you mean" function
+         An automaton is used by one thread; any number of them can share a Corpus
 */
 class LevenshteinAutomaton
   {
    public: // Types
       typedef std::tuple<int, int>              NState;
       typedef typename std::set<NState>         DState;
+      typedef std::pair<std::string, unsigned>  Match;      ///< a found word and its edit distance
+      typedef std::vector<Match>                MatchVec;
+
+      /// How the deterministic automaton for a query is obtained
+      enum Mode
+      {
+          SUBSET_CONSTRUCTION,  ///< build the NFA and determinize it
+          PARAMETRIC,           ///< apply the precomputed universal tables (k <= MAX_PARAMETRIC_DISTANCE)
+          BIT_PARALLEL,         ///< compute the edit distance bit-parallel (words up to BitParallelAutomaton::MAX_LENGTH)
+          COLUMNAR_SCAN,        ///< no automaton, compare with all corpus words of a suitable length using SIMD
+          LAZY_DFA              ///< build the NFA and determinize only the states the search visits
+      };
 
    private: // Types
       typedef std::string                       Word;
       typedef std::vector<Word>                 WordVec;
+      typedef std::shared_ptr<NFAutomaton>      NFAPtr;
+
+      /// Takes the place of an automaton when the ColumnarCorpus is scanned; its states are the distances
+      struct ColumnarScan
+      {
+          typedef unsigned State;
+
+          unsigned distance(const State& state) const { return state; }
+          unsigned min_distance(const State& state) const { return state; }
+      };
 
 
    public: // Functions
@@ -42,16 +76,57 @@ class LevenshteinAutomaton
       @brief Constructor from word and maximum edit distance
       @param Word w
       @param maximum edit distance k
-      @param database corpus of words
+      @param database corpus of words, which is copied; prefer sharing a Corpus
+      @param mode, how the automaton is built; PARAMETRIC falls back to
+             SUBSET_CONSTRUCTION if k is larger than MAX_PARAMETRIC_DISTANCE,
+             BIT_PARALLEL if the word is longer than BitParallelAutomaton::MAX_LENGTH,
+             COLUMNAR_SCAN if the corpus has no ColumnarCorpus or k is larger than ColumnarCorpus::MAX_DISTANCE;
+             the copy gets no ColumnarCorpus, whose transposition costs more than a scan saves, so COLUMNAR_SCAN
+             always falls back here and needs a shared Corpus(words, indexed, true);
+             all of them fall back for other costs than EditCosts::levenshtein(),
+             LAZY_DFA for costs over UTF-8
+      @param costs, the cost of every edit operation, k is the largest total cost;
+             an insertion, deletion or substitution cost of 0 counts as 1
+    */
+    LevenshteinAutomaton(const Word& input, const unsigned& distance, const WordVec& words,
+                         const Mode& mode = SUBSET_CONSTRUCTION, const EditCosts& costs = EditCosts::levenshtein())
+    {
+        lookupword = input;
+        k = distance;
+        this->costs = costs.clamped();
+        corpus = std::make_shared<Corpus>(words, false);
+        initialized = false;
+        stats = QueryStats();
+
+        select_mode(mode);
+     }
+
+    /**
+      @brief Constructor from word, maximum edit distance and a shared corpus
+             The corpus is not copied, so the cost of this constructor does not depend on its size;
+             if the corpus has an index, the automaton is walked through it in lockstep
+      @param Word w
+      @param maximum edit distance k
+      @param words, the shared corpus
+      @param mode, how the automaton is built
+      @param costs, the cost of every edit operation, k is the largest total cost;
+             an insertion, deletion or substitution cost of 0 counts as 1
+      @param cache, where the CompiledDFA is taken from or added to, if given;
+             a cached automaton skips building the NFA as well
     */
-    LevenshteinAutomaton(const Word& input, const unsigned& distance, const WordVec& words)
+    LevenshteinAutomaton(const Word& input, const unsigned& distance, const CorpusPtr& words,
+                         const Mode& mode = SUBSET_CONSTRUCTION, const EditCosts& costs = EditCosts::levenshtein(),
+                         const DFACachePtr& cache = nullptr)
     {
         lookupword = input;
         k = distance;
+        this->costs = costs.clamped();
+        this->cache = cache;
         corpus = words;
-        NFAutomaton nfa(std::make_tuple(0, 0));
+        initialized = false;
+        stats = QueryStats();
 
-        init();
+        select_mode(mode);
      }
 
 
@@ -60,39 +135,191 @@ class LevenshteinAutomaton
       @return A vector containing all the words
     */
     WordVec get_all_matches()
+    {
+        if (engine == PARAMETRIC) { return list_matches(pdfa); }
+        if (engine == BIT_PARALLEL) { return list_matches(bdfa); }
+        if (engine == LAZY_DFA) { return list_matches(ldfa); }
+        if (engine == COLUMNAR_SCAN) { return list_matches(ColumnarScan()); }
+        return list_matches(get_compiled_dfa());
+
+    } // get_all_matches
+
+    /**
+      @brief Returns all the words within Levenshtein distance k in the given corpus, grouped by their distance
+             The corpus is searched once, the distance of every match is read off its final state
+      @return A vector of k+1 vectors, the i-th one contains the words in distance i, sorted
+    */
+    std::vector<WordVec> get_matches_by_distance()
+    {
+        if (engine == PARAMETRIC) { return group_matches(pdfa); }
+        if (engine == BIT_PARALLEL) { return group_matches(bdfa); }
+        if (engine == LAZY_DFA) { return group_matches(ldfa); }
+        if (engine == COLUMNAR_SCAN) { return group_matches(ColumnarScan()); }
+        return group_matches(get_compiled_dfa());
+
+    } // get_matches_by_distance
+
+    /**
+      @brief Returns the words with the smallest distance to the lookup word, if it is at most k
+             Parts of the corpus that cannot beat the closest words found so far are skipped,
+             so the search costs little more than one with the smallest k that has matches
+      @param distance, receives the distance of the found words, k+1 if there are none
+      @return A vector containing the closest words, sorted
+    */
+    WordVec get_closest_matches(unsigned& distance)
+    {
+        if (engine == PARAMETRIC) { return closest_matches(pdfa, distance); }
+        if (engine == BIT_PARALLEL) { return closest_matches(bdfa, distance); }
+        if (engine == LAZY_DFA) { return closest_matches(ldfa, distance); }
+        if (engine == COLUMNAR_SCAN) { return closest_matches(ColumnarScan(), distance); }
+        return closest_matches(get_compiled_dfa(), distance);
+
+    } // get_closest_matches
+
+    /**
+      @brief Returns all the words within Levenshtein distance k in the given corpus together with their distance
+             The distance is read off the final state of every match, no word is compared again
+      @return A vector of (word, distance) pairs, sorted by word
+    */
+    MatchVec get_scored_matches()
+    {
+        if (engine == PARAMETRIC) { return scored_matches(pdfa); }
+        if (engine == BIT_PARALLEL) { return scored_matches(bdfa); }
+        if (engine == LAZY_DFA) { return scored_matches(ldfa); }
+        if (engine == COLUMNAR_SCAN) { return scored_matches(ColumnarScan()); }
+        return scored_matches(get_compiled_dfa());
+
+    } // get_scored_matches
+
+    /**
+      @brief Returns the n words closest to the lookup word within distance k
+             Parts of the corpus that cannot beat the n-th best word found so far are skipped
+      @param n, the number of words wanted
+      @return At most n (word, distance) pairs, sorted by distance and words of the same distance alphabetically
+    */
+    MatchVec get_top_matches(const std::size_t& n)
+    {
+        if (engine == PARAMETRIC) { return top_matches(pdfa, n); }
+        if (engine == BIT_PARALLEL) { return top_matches(bdfa, n); }
+        if (engine == LAZY_DFA) { return top_matches(ldfa, n); }
+        if (engine == COLUMNAR_SCAN) { return top_matches(ColumnarScan(), n); }
+        return top_matches(get_compiled_dfa(), n);
+
+    } // get_top_matches
+
+    /**
+      @brief Returns the words of the corpus that begin with a prefix within Levenshtein distance k,
+             e.g. the completions of a word still being typed
+             Once a path of the index reaches a final state, the whole subtree below it is listed
+             without the automaton, as if the final states were absorbing under ANY;
+             the walk stops as soon as limit words are found, so few results cost little even on a large corpus
+      @param limit, the largest number of words wanted
+      @return At most limit words, the lexicographically first ones, sorted
+    */
+    WordVec get_prefix_matches(const std::size_t& limit)
+    {
+        if (engine == PARAMETRIC) { return prefix_matches(pdfa, limit); }
+        if (engine == BIT_PARALLEL) { return prefix_matches(bdfa, limit); }
+        if (engine == LAZY_DFA) { return prefix_matches(ldfa, limit); }
+        return prefix_matches(get_compiled_dfa(), limit);
+
+    } // get_prefix_matches
+
+    /**
+      @brief Calls a function with every word within Levenshtein distance k and its distance as soon as it is found,
+             in lexicographic order; nothing is collected, so memory does not grow with the number of matches
+             and the search ends as soon as the function asks for it
+      @param visit, is called as visit(word, distance) and returns false to end the search;
+             the word is only valid during the call
+      @return The number of words the function was called with
+    */
+    template<class Visit>
+    std::size_t for_each_match(Visit visit)
+    {
+        if (engine == PARAMETRIC) { return stream_matches(pdfa, visit); }
+        if (engine == BIT_PARALLEL) { return stream_matches(bdfa, visit); }
+        if (engine == LAZY_DFA) { return stream_matches(ldfa, visit); }
+        if (engine == COLUMNAR_SCAN) { return stream_matches(ColumnarScan(), visit); }
+        return stream_matches(get_compiled_dfa(), visit);
+
+    } // for_each_match
+
+    /**
+      @brief Returns the first words within Levenshtein distance k, the search stops once they are found
+      @param limit, the largest number of words wanted
+      @return At most limit words, the lexicographically first ones, sorted
+    */
+    WordVec get_first_matches(const std::size_t& limit)
     {
         WordVec matchWords;
-        dfa = nfa.to_dfa();
+        if (limit == 0) { return matchWords; }
 
-        Word match = dfa.next_valid(NUL);
+        for_each_match([&](const Word& word, const unsigned&) {
+            matchWords.push_back(word);
+            return matchWords.size() < limit;
+        });
 
-        while (match != NONE) {
-            // Find the first word in the corpus that is lexicographically greater than or equal to the current match
-            Word next = next_in_corpus(match);
+        return matchWords;
 
-            if (next == NONE) {
-                // If there is no next word in the corpus, all matches have been found
-                return matchWords;
-            }
+    } // get_first_matches
 
-            // If the current match is a valid word in the corpus, it is added to the matches
-            if (match == next) {
-                matchWords.push_back(match);
-                next = next + NUL;
+    /**
+      @brief Returns a list of all the words within Levenshtein distance k in the given corpus,
+             searching disjoint parts of the corpus index on all threads of a pool
+             Without an index, with COLUMNAR_SCAN or with LAZY_DFA, whose cache cannot be shared, the search is not split
+      @param pool, the threads to use
+      @return A vector containing all the words
+    */
+    WordVec get_all_matches(WorkStealingPool& pool)
+    {
+        if (corpus->has_index() == false || engine == COLUMNAR_SCAN || engine == LAZY_DFA) { return get_all_matches(); }
+
+        if (engine == PARAMETRIC) { return walk_index(pdfa, pool); }
+        if (engine == BIT_PARALLEL) { return walk_index(bdfa, pool); }
+        return walk_index(get_compiled_dfa(), pool);
+
+    } // get_all_matches
+
+    /**
+      @brief Returns the deterministic automaton built by subset construction
+             It is determinized on the first call only, or taken from the cache
+    */
+    const CompiledDFA& get_compiled_dfa()
+    {
+        if (cdfa == nullptr) {
+            if (cache != nullptr) {
+                cdfa = cache->get(lookupword, k, costs, [this]() { return build_compiled_dfa(); });
+            }
+            else {
+                cdfa = std::make_shared<const CompiledDFA>(build_compiled_dfa());
             }
-            match = dfa.next_valid(next);
         }
 
-        return matchWords;
+        return *cdfa;
 
-    } // get_all_matches
+    } // get_compiled_dfa
+
+    /**
+      @brief Returns what the lookups of this automaton counted and how long their phases took
+             Everything stays 0 unless LEV_ENABLE_STATS is set; see LevStats for the totals of the process
+    */
+    const QueryStats& statistics() const
+    {
+        return stats;
+
+    } // statistics
 
     /**
         @brief Prints the whole Lev automaton in a readable way
+               This is the CompiledDFA of get_compiled_dfa(), determinized completely for LAZY_DFA
+        @return false if the chosen engine has no automaton to print
     */
-    void lev_printer() const
+    bool lev_printer()
     {
-        dfa.dfa_printer();
+        if (has_compiled_dfa() == false) { return false; }
+
+        get_compiled_dfa().dfa_printer();
+        return true;
 
     } // lev_printer
 
@@ -100,73 +327,674 @@ class LevenshteinAutomaton
     /**
         @brief Prints a dot representation of the Lev Automaton to stream 'out'
         @param ostream out
-    */
-    void lev_to_dot(std::ostream& out) const
-    {
-        dfa.dfa_to_dot(out);
-
+        @return false if the chosen engine has no automaton to print, nothing is written then
+    */
+    bool lev_to_dot(std::ostream& out)
+    {
+        if (has_compiled_dfa() == false) { return false; }
+
+        get_compiled_dfa().dfa_to_dot(out);
+        return true;
+
     } // dot_out
 
 
    private: // Functions
-   /**
-      @brief Starts building the complete automaton
+    /**
+      @brief Tells whether the chosen engine steps through an NFA, which get_compiled_dfa() determinizes;
+             PARAMETRIC, BIT_PARALLEL and COLUMNAR_SCAN compute the distances without one
+    */
+    bool has_compiled_dfa() const
+    {
+        return engine == SUBSET_CONSTRUCTION || engine == LAZY_DFA;
+
+    } // has_compiled_dfa
+
+    /**
+      @brief Prepares the automaton for the chosen mode
+      @param mode, how the automaton is built
+    */
+    void select_mode(const Mode& mode)
+    {
+        // Only the NFA can be built for any costs, the other engines compute the Levenshtein distance
+        engine = SUBSET_CONSTRUCTION;
+        if (costs == EditCosts::levenshtein()) {
+            if (mode == PARAMETRIC && k <= MAX_PARAMETRIC_DISTANCE) { engine = PARAMETRIC; }
+            if (mode == BIT_PARALLEL && BitParallelAutomaton::supports(lookupword) == true) { engine = BIT_PARALLEL; }
+            if (mode == COLUMNAR_SCAN && k <= ColumnarCorpus::MAX_DISTANCE && corpus->has_columns() == true) { engine = COLUMNAR_SCAN; }
+        }
+        // The lazy automaton steps through the NFA bytewise
+        if (mode == LAZY_DFA && costs.utf8 == false) { engine = LAZY_DFA; }
+
+        if (engine == PARAMETRIC) {
+            pdfa = ParametricAutomaton(lookupword, k);
+        }
+        else if (engine == BIT_PARALLEL) {
+            bdfa = BitParallelAutomaton(lookupword, k);
+        }
+        else if (engine == LAZY_DFA) {
+            init();
+            LEV_PHASE(DETERMINIZE, stats);
+            ldfa = LazyDFA(nfa);
+        }
+        else if (engine == SUBSET_CONSTRUCTION && cache == nullptr) {
+            init();
+        }
+
+    } // select_mode
+
+    /**
+      @brief Lists all matches of the given automaton
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @return A vector containing all the words, sorted
+    */
+    template<class Automaton>
+    WordVec list_matches(const Automaton& automaton) const
+    {
+        typedef typename Automaton::State State;
+
+        WordVec matchWords;
+        search(automaton,
+               [&matchWords](const Word& word, const State&) { matchWords.push_back(word); return true; },
+               [](const State&) { return true; });
+
+        return matchWords;
+
+    } // list_matches
+
+    /**
+      @brief Lists all matches of the given automaton by their distance
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @return A vector of k+1 vectors, the i-th one contains the words in distance i
+    */
+    template<class Automaton>
+    std::vector<WordVec> group_matches(const Automaton& automaton) const
+    {
+        typedef typename Automaton::State State;
+
+        std::vector<WordVec> groups(k + 1);
+        search(automaton,
+               [&](const Word& word, const State& state) { groups[automaton.distance(state)].push_back(word); return true; },
+               [](const State&) { return true; });
+
+        return groups;
+
+    } // group_matches
+
+    /**
+      @brief Lists the matches of the given automaton with the smallest distance
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @param distance, receives the smallest distance, k+1 if there are no matches
+      @return A vector containing the closest words
+    */
+    template<class Automaton>
+    WordVec closest_matches(const Automaton& automaton, unsigned& distance) const
+    {
+        typedef typename Automaton::State State;
+
+        // The bound shrinks to the best distance found so far, paths that cannot reach it any more are dropped
+        WordVec matchWords;
+        unsigned bound = k;
+        search(automaton,
+               [&](const Word& word, const State& state) {
+                   unsigned d = automaton.distance(state);
+                   if (d > bound) { return true; }
+                   if (d < bound || matchWords.empty() == true) {
+                       matchWords.clear();
+                       bound = d;
+                   }
+                   matchWords.push_back(word);
+                   return true;
+               },
+               [&](const State& state) { return automaton.min_distance(state) <= bound; });
+
+        distance = matchWords.empty() ? k + 1 : bound;
+        return matchWords;
+
+    } // closest_matches
+
+    /**
+      @brief Lists all matches of the given automaton with their distance
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @return A vector of (word, distance) pairs
+    */
+    template<class Automaton>
+    MatchVec scored_matches(const Automaton& automaton) const
+    {
+        typedef typename Automaton::State State;
+
+        MatchVec matches;
+        search(automaton,
+               [&](const Word& word, const State& state) { matches.push_back(Match(word, automaton.distance(state))); return true; },
+               [](const State&) { return true; });
+
+        return matches;
+
+    } // scored_matches
+
+    /**
+      @brief Lists the n best matches of the given automaton
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @param n, the number of matches wanted
+      @return The best matches ordered by distance, then by word
+    */
+    template<class Automaton>
+    MatchVec top_matches(const Automaton& automaton, const std::size_t& n) const
+    {
+        typedef typename Automaton::State State;
+
+        // The best matches so far are kept in a heap with the worst one on top
+        auto better = [](const Match& a, const Match& b) {
+            return a.second < b.second || (a.second == b.second && a.first < b.first);
+        };
+
+        MatchVec best;
+        if (n == 0) { return best; }
+
+        search(automaton,
+               [&](const Word& word, const State& state) {
+                   Match m(word, automaton.distance(state));
+                   if (best.size() == n) {
+                       if (better(m, best.front()) == false) { return true; }
+                       std::pop_heap(best.begin(), best.end(), better);
+                       best.pop_back();
+                   }
+                   best.push_back(m);
+                   std::push_heap(best.begin(), best.end(), better);
+                   return true;
+               },
+               [&](const State& state) {
+                   // Words are found in alphabetical order, so once n words are kept
+                   // a later word has to be strictly closer than the worst of them
+                   return best.size() < n || automaton.min_distance(state) < best.front().second;
+               });
+
+        std::sort_heap(best.begin(), best.end(), better);
+        return best;
+
+    } // top_matches
+
+    /**
+      @brief Hands every match of the given automaton to a function until it returns false
+      @param automaton, the automaton for the lookup word
+      @param visit, is called with every word and its distance
+      @return The number of words handed over
+    */
+    template<class Automaton, class Visit>
+    std::size_t stream_matches(const Automaton& automaton, Visit& visit) const
+    {
+        typedef typename Automaton::State State;
+
+        std::size_t count = 0;
+        search(automaton,
+               [&](const Word& word, const State& state) {
+                   count++;
+                   return visit(word, automaton.distance(state)) == true;
+               },
+               [](const State&) { return true; });
+
+        return count;
+
+    } // stream_matches
+
+    /**
+      @brief Lists the first words that begin with a match of the given automaton
+      @param automaton, a CompiledDFA, ParametricAutomaton or BitParallelAutomaton for the lookup word
+      @param limit, the largest number of words wanted
+      @return At most limit words, sorted
+    */
+    template<class Automaton>
+    WordVec prefix_matches(const Automaton& automaton, const std::size_t& limit) const
+    {
+        typedef typename Automaton::State State;
+        LEV_PHASE(TRAVERSE, stats);
+
+        WordVec matchWords;
+        if (limit == 0) { return matchWords; }
+
+        State start = automaton.start();
+        if (automaton.is_dead(start) == true) { return matchWords; }
+
+        if (corpus->has_index() == false) {
+            // Run the automaton over every word until a prefix is final or the automaton dies
+            for (auto& word: corpus->get_words()) {
+                State state = start;
+                bool matched = automaton.is_final(state);
+                for (std::size_t j = 0; j < word.size() && matched == false; j++) {
+                    state = automaton.next_state(state, word[j]);
+                    if (automaton.is_dead(state) == true) { break; }
+                    matched = automaton.is_final(state);
+                }
+
+                LEV_COUNT(corpus_probes, 1);
+                if (matched == true) {
+                    LEV_COUNT(matches, 1);
+                    matchWords.push_back(word);
+                    if (matchWords.size() == limit) { break; }
+                }
+            }
+
+            return matchWords;
+        }
+
+        // A node of the index, the automaton state for the same path, the next edge to follow
+        // and whether the path already has a prefix within k; below such a node every word is a match
+        struct Frame
+        {
+            CorpusIndex::NodeId         node;
+            State                       state;
+            const CorpusIndex::Edge*    edge;
+            bool                        matched;
+        };
+
+        const CorpusIndex* index = &corpus->get_index();
+        Word path;
+        std::vector<Frame> stack;
+
+        Frame first = {index->root(), start, index->edges_begin(index->root()), automaton.is_final(start)};
+        if (index->is_final(first.node) && first.matched) {
+            LEV_COUNT(matches, 1);
+            matchWords.push_back(path);
+        }
+        stack.push_back(first);
+
+        while (stack.size() > 0 && matchWords.size() < limit) {
+            Frame& top = stack.back();
+
+            if (top.edge == index->edges_end(top.node)) {
+                stack.pop_back();
+                if (path.size() > 0) { path.pop_back(); }
+                continue;
+            }
+
+            const CorpusIndex::Edge* edge = top.edge++;
+            LEV_COUNT(index_edges, 1);
+            Frame next = {edge->target, top.state, index->edges_begin(edge->target), top.matched};
+            if (next.matched == false) {
+                next.state = automaton.next_state(top.state, edge->symbol);
+                if (automaton.is_dead(next.state) == true) { continue; }
+                next.matched = automaton.is_final(next.state);
+            }
+
+            path.push_back(static_cast<char>(edge->symbol));
+            if (index->is_final(next.node) && next.matched) {
+                LEV_COUNT(matches, 1);
+                matchWords.push_back(path);
+            }
+            stack.push_back(next);
+        } // while
+
+        return matchWords;
+
+    } // prefix_matches
+
+    /**
+      @brief Searches the corpus with the given automaton, through the index if there is one
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @param accept, is called with every match and its final state, in lexicographic order,
+             and returns false to stop the search
+      @param keep, is asked whether the search shall go on from a state; only used with an index
+    */
+    template<class Automaton, class Accept, class Keep>
+    void search(const Automaton& automaton, Accept accept, Keep keep) const
+    {
+        LEV_PHASE(TRAVERSE, stats);
+        if (corpus->has_index() == true) {
+            walk_index(automaton, accept, keep);
+        }
+        else {
+            collect_matches(automaton, accept);
+        }
+
+    } // search
+
+    /**
+      @brief Scans the ColumnarCorpus for all matches, regardless of an index
+      @param accept, is called with every match and its distance, in lexicographic order,
+             and returns false to stop the search
+    */
+    template<class Accept, class Keep>
+    void search(const ColumnarScan&, Accept accept, Keep) const
+    {
+        LEV_PHASE(TRAVERSE, stats);
+        // The hits come bucket by bucket, their positions restore the order of the sorted words
+        std::vector<ColumnarCorpus::Hit> hits;
+        corpus->get_columns().scan(lookupword, k, hits);
+        std::sort(hits.begin(), hits.end());
+
+        const WordVec& words = corpus->get_words();
+        LEV_COUNT(corpus_probes, words.size());
+        for (auto& h: hits) {
+            LEV_COUNT(matches, 1);
+            if (accept(words[h.first], h.second) == false) { return; }
+        }
+
+    } // search
+
+    /**
+      @brief Walks the corpus and the given automaton in turns to collect all matches
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @param accept, is called with every match and its final state, in lexicographic order,
+             and returns false to stop
+    */
+    template<class Automaton, class Accept>
+    void collect_matches(const Automaton& automaton, Accept accept) const
+    {
+        // The buffers are reused by every call of next_valid, which resumes from the path of the previous match
+        Word match;
+        Word next;
+        std::vector<typename Automaton::State> stack;
+        bool found = automaton.next_valid(NONE, match, stack);
+
+        while (found == true) {
+            // Find the first word in the corpus that is lexicographically greater than or equal to the current match;
+            // if there is none, all matches have been found
+            LEV_COUNT(corpus_probes, 1);
+            if (corpus->next_in_corpus(match, next) == false) { return; }
+
+            // If the current match is a valid word in the corpus, it is added to the matches
+            // The last state on the stack is the one the match ends in
+            if (match == next) {
+                LEV_COUNT(matches, 1);
+                if (accept(match, stack.back()) == false) { return; }
+                next.push_back(NUL);
+            }
+            found = automaton.next_valid(next, match, stack);
+        }
+
+    } // collect_matches
+
+    /**
+      @brief Computes the distance of every corpus word of a suitable length to collect all matches
+             The bit-parallel automaton cannot look for the next valid word, but checks a word so fast
+             that comparing each one is competitive
+      @param automaton, the BitParallelAutomaton for the lookup word
+      @param accept, is called with every match and its final state, in lexicographic order,
+             and returns false to stop
+    */
+    template<class Accept>
+    void collect_matches(const BitParallelAutomaton& automaton, Accept accept) const
+    {
+        BitParallelAutomaton::State state;
+        for (auto& word: corpus->get_words()) {
+            LEV_COUNT(corpus_probes, 1);
+            if (automaton.scan(word, state) == true) {
+                LEV_COUNT(matches, 1);
+                if (accept(word, state) == false) { return; }
+            }
+        }
+
+    } // collect_matches
+
+    /**
+      @brief Walks the corpus index and the given automaton in lockstep to collect all matches
+             A subtree of the index is skipped as soon as the automaton dies on its path
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @param accept, is called with every match and its final state, in lexicographic order,
+             and returns false to stop the walk
+      @param keep, is asked whether the walk shall go on from a state
+    */
+    template<class Automaton, class Accept, class Keep>
+    void walk_index(const Automaton& automaton, Accept accept, Keep keep) const
+    {
+        const CorpusIndex* index = &corpus->get_index();
+        Word path;
+
+        typename Automaton::State state = automaton.start();
+        if (automaton.is_dead(state) == true || keep(state) == false) { return; }
+
+        if (index->is_final(index->root()) && automaton.is_final(state)) {
+            LEV_COUNT(matches, 1);
+            if (accept(path, state) == false) { return; }
+        }
+        walk_subtree(automaton, index->root(), state, path, accept, keep);
+
+    } // walk_index
+
+    /**
+      @brief Walks the corpus index and the given automaton in lockstep on all threads of a pool
+             The index is cut into the subtrees below its first levels, which are walked in parallel
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @param pool, the threads to use
+      @return A vector containing all the words, sorted
+    */
+    template<class Automaton>
+    WordVec walk_index(const Automaton& automaton, WorkStealingPool& pool) const
+    {
+        typedef typename Automaton::State State;
+        LEV_PHASE(TRAVERSE, stats);
+
+        // A node of the index reached by the automaton, to be searched including its subtree
+        // or, if it is a leaf, only the node itself
+        struct Shard
+        {
+            CorpusIndex::NodeId         node;
+            State                       state;
+            Word                        path;
+            bool                        leaf;
+        };
+
+        const CorpusIndex* index = &corpus->get_index();
+        std::vector<Shard> shards;
+
+        Shard first = {index->root(), automaton.start(), Word(), false};
+        if (automaton.is_dead(first.state) == true) { return WordVec(); }
+        shards.push_back(first);
+
+        // Replace every shard by its node and its children, level by level and in order,
+        // until there are enough shards for the stealing to even out their sizes
+        for (unsigned level = 0; level < 4 && shards.size() < 16 * pool.size(); level++) {
+            std::vector<Shard> children;
+            for (auto& s: shards) {
+                if (s.leaf == true) {
+                    children.push_back(s);
+                    continue;
+                }
+
+                if (index->is_final(s.node) && automaton.is_final(s.state)) {
+                    Shard leaf = {s.node, s.state, s.path, true};
+                    children.push_back(leaf);
+                }
+
+                for (auto edge = index->edges_begin(s.node); edge != index->edges_end(s.node); edge++) {
+                    State state = automaton.next_state(s.state, edge->symbol);
+                    if (automaton.is_dead(state) == true) { continue; }
+
+                    Shard child = {edge->target, state, s.path + static_cast<char>(edge->symbol), false};
+                    children.push_back(child);
+                }
+            }
+            shards.swap(children);
+        }
+
+        std::vector<WordVec> parts(shards.size());
+#if LEV_ENABLE_STATS
+        // What every shard counted on whichever thread, handed back to this one
+        std::vector<LevCounters> counted(shards.size(), LevCounters());
+#endif
+        pool.parallel_for(shards.size(), [&](std::size_t i) {
+#if LEV_ENABLE_STATS
+            LevStats::Handoff handoff(counted[i]);
+#endif
+            Shard& s = shards[i];
+            if (s.leaf == true || (index->is_final(s.node) && automaton.is_final(s.state))) {
+                parts[i].push_back(s.path);
+            }
+            if (s.leaf == false) {
+                walk_subtree(automaton, s.node, s.state, s.path,
+                             [&parts, i](const Word& word, const State&) { parts[i].push_back(word); return true; },
+                             [](const State&) { return true; });
+            }
+        });
+
+        // The shards are in order, so are their matches
+        WordVec matchWords;
+        for (auto& part: parts) {
+            matchWords.insert(matchWords.end(), part.begin(), part.end());
+        }
+#if LEV_ENABLE_STATS
+        for (auto& c: counted) { LevStats::add(LevStats::local(), c); }
+#endif
+
+        return matchWords;
+
+    } // walk_index
+
+    /**
+      @brief Walks the subtree below a node of the corpus index in lockstep with the given automaton
+             A subtree is skipped as soon as the automaton dies on its path
+      @param automaton, a CompiledDFA or ParametricAutomaton for the lookup word
+      @param node, the node whose descendants are searched
+      @param state, the state of the automaton at this node
+      @param path, the word leading to the node, unchanged on return
+      @param accept, is called with every match below the node and its final state, in lexicographic order,
+             and returns false to stop the walk
+      @param keep, is asked whether the walk shall go on from a state
+    */
+    template<class Automaton, class Accept, class Keep>
+    void walk_subtree(const Automaton& automaton, const CorpusIndex::NodeId& node,
+                      const typename Automaton::State& state, Word& path, Accept accept, Keep keep) const
+    {
+        typedef typename Automaton::State State;
+
+        // A node of the index, the automaton state for the same path and the next edge to follow
+        struct Frame
+        {
+            CorpusIndex::NodeId         node;
+            State                       state;
+            const CorpusIndex::Edge*    edge;
+        };
+
+        const CorpusIndex* index = &corpus->get_index();
+        std::size_t depth = path.size();
+        std::vector<Frame> stack;
+
+        Frame first = {node, state, index->edges_begin(node)};
+        stack.push_back(first);
+
+        while (stack.size() > 0) {
+            Frame& top = stack.back();
+
+            // All edges of this node are done, go back to its parent
+            if (top.edge == index->edges_end(top.node)) {
+                stack.pop_back();
+                if (path.size() > depth) { path.pop_back(); }
+                continue;
+            }
+
+            const CorpusIndex::Edge* edge = top.edge++;
+            LEV_COUNT(index_edges, 1);
+            State state = automaton.next_state(top.state, edge->symbol);
+            if (automaton.is_dead(state) == true || keep(state) == false) { continue; }
+
+            path.push_back(static_cast<char>(edge->symbol));
+            if (index->is_final(edge->target) && automaton.is_final(state)) {
+                LEV_COUNT(matches, 1);
+                if (accept(path, state) == false) {
+                    path.resize(depth);
+                    return;
+                }
+            }
+
+            Frame next = {edge->target, state, index->edges_begin(edge->target)};
+            stack.push_back(next);
+        } // while
+
+    } // walk_subtree
+
+   /**
+      @brief Starts building the complete automaton
+             The state (i, e) has read i symbols of the lookup word at a cost of e;
+             (-1-i, e) has read the symbol i+1 in place of the symbol i and waits for the symbol i to complete a transposition
+             The symbols are bytes, or codepoints if the costs are over UTF-8
    */
       void init()
       {
-        for(int i = 0; i < lookupword.size(); ++i) {
+        if (initialized == true) { return; }
+        initialized = true;
+        LEV_PHASE(NFA, stats);
+        nfa = std::make_shared<NFAutomaton>();
+
+        std::vector<Label> symbols;
+        if (costs.utf8 == true) {
+            for (auto c: Utf8::decode(lookupword)) { symbols.push_back(Label::symbol(c)); }
+        }
+        else {
+            for (auto c: lookupword) { symbols.push_back(Label::byte(c)); }
+        }
+
+        for (std::size_t i = 0; i < symbols.size(); ++i) {
             for (unsigned e = 0; e <= k; e++) {
 
                 // Transitions with all the characters from the input word
-                std::string s(1, lookupword[i]);
-                nfa.add_transition(std::make_tuple(i, e), s, std::make_tuple(i+1, e));
+                nfa->add_transition(std::make_tuple(i, e), symbols[i], std::make_tuple(i+1, e));
 
-                if (e < k) {
+                // Transitions for deletion in the Levenshtein distance algorithm
+                if (e + costs.deletion <= k) {
+                    nfa->add_transition(std::make_tuple(i, e), Label::any(), std::make_tuple(i, e + costs.deletion));
+                }
 
-                    // Transitions for deletion in the Levenshtein distance algorithm
-                    nfa.add_transition(std::make_tuple(i, e), ANY, std::make_tuple(i, e+1));
+                // Transitions for insertion in the Levenshtein distance algorithm
+                if (e + costs.insertion <= k) {
+                    nfa->add_transition(std::make_tuple(i, e), Label::epsilon(), std::make_tuple(i+1, e + costs.insertion));
+                }
 
-                    // Transitions for insertion in the Levenshtein distance algorithm
-                    nfa.add_transition(std::make_tuple(i, e), EPSILON, std::make_tuple(i+1, e+1));
+                // Transitions for substitution in the Levenshtein distance algorithm
+                if (e + costs.substitution <= k) {
+                    nfa->add_transition(std::make_tuple(i, e), Label::any(), std::make_tuple(i+1, e + costs.substitution));
+                }
 
-                    // Transitions for substitution in the Levenshtein distance algorithm
-                    nfa.add_transition(std::make_tuple(i, e), ANY, std::make_tuple(i+1, e+1));
+                // Transitions for transposition in the Damerau-Levenshtein distance algorithm
+                if (costs.transposition > 0 && e + costs.transposition <= k
+                    && i + 1 < symbols.size() && symbols[i] != symbols[i+1]) {
+                    unsigned t = e + costs.transposition;
+                    int waiting = -1 - static_cast<int>(i);
+                    nfa->add_transition(std::make_tuple(i, e), symbols[i+1], std::make_tuple(waiting, t));
+                    nfa->add_transition(std::make_tuple(waiting, t), symbols[i], std::make_tuple(i+2, t));
                 }
             } // for e
-        } // for lookupword
+        } // for symbols
 
         for (unsigned e = 0; e <= k; e++) {
-            if (e < k) {
-                nfa.add_transition(std::make_tuple(lookupword.size(), e), ANY, std::make_tuple(lookupword.size(), e+1));
+            if (e + costs.deletion <= k) {
+                nfa->add_transition(std::make_tuple(symbols.size(), e), Label::any(), std::make_tuple(symbols.size(), e + costs.deletion));
             }
-            nfa.add_final_state(std::make_tuple(lookupword.size(), e));
+            nfa->add_final_state(std::make_tuple(symbols.size(), e));
         }
 
       } // init
 
-     /**
-      @brief Returns returns the first word in the corpus that is lexicographically greater than or equal to the input word.
-      @param word input
+    /**
+      @brief Builds the NFA and determinizes it, minimizing the result if LEV_MINIMIZE_DFA is set
+             An NFA over codepoints is compiled to UTF-8 bytes
     */
-    Word next_in_corpus(const Word& input) const
+    CompiledDFA build_compiled_dfa()
     {
-        auto pos = std::lower_bound(corpus.begin(), corpus.end(), input);
-        if (pos != corpus.end()) {
-            return *pos;
-            }
+        init();
+        LEV_PHASE(DETERMINIZE, stats);
+        CompiledDFA dfa = costs.utf8 == true ? nfa->to_utf8_dfa() : nfa->to_compiled_dfa();
+        if (LEV_MINIMIZE_DFA != 0) { return dfa.minimize(); }
 
-        return NONE;
+        return dfa;
 
-    } // next_in_corpus
+    } // build_compiled_dfa
 
 
 
    private: // variables
-      NFAutomaton       nfa;        ///< the actual Levenshtein automaton
-      DFAutomaton       dfa;        ///< and its deterministic equivalent
-      WordVec           corpus;     ///< the list of all possible words
-      unsigned          k;          ///< the max. allowed Lev-distance
-      Word              lookupword; ///< all words in Lev-distance k from this word are searched
+      NFAPtr                nfa;        ///< the actual Levenshtein automaton, shared with ldfa
+      DFACache::DFAPtr      cdfa;       ///< and its deterministic equivalent, possibly shared through the cache
+      ParametricAutomaton   pdfa;       ///< the universal automaton applied to the lookup word
+      BitParallelAutomaton  bdfa;       ///< the bit-parallel distance computation for the lookup word
+      LazyDFA               ldfa;       ///< the NFA determinized on demand
+      Mode                  engine;     ///< which of cdfa, pdfa, bdfa and ldfa is used
+      CorpusPtr             corpus;     ///< the list of all possible words
+      unsigned              k;          ///< the max. allowed Lev-distance
+      EditCosts             costs;      ///< what every edit operation adds to the distance
+      DFACachePtr           cache;      ///< the cache of compiled automata, if any
+      bool                  initialized; ///< whether init() has built the NFA
+      Word                  lookupword; ///< all words in Lev-distance k from this word are searched
+      mutable QueryStats    stats;      ///< what the lookups counted, if LEV_ENABLE_STATS is set
 
   }; // LevenshteinAutomaton
 
@@ -0,0 +1,296 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+The binary protocol of lev_server
+*/
+
+#ifndef LEVPROTOCOL_HPP_INCLUDED
+#define LEVPROTOCOL_HPP_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+  @brief LevProtocol encodes and decodes the frames lev_server and its clients exchange over a stream socket
+         Every frame starts with its size as a u32, not counting these 4 bytes; all integers are little endian
+         Request:  u32 size, u32 id, u8 op, u8 k, u8 flags, u8 mode, u32 limit, u32 count,
+                   count times (u16 length, the bytes of a lookup word)
+         Response: u32 size, u32 id, u8 status, 3 zero bytes, u32 latency in microseconds, u32 count,
+                   count times (u32 matches, matches times (u8 distance, u16 length, the bytes of a word))
+         A client may send any number of requests without waiting; the responses come in the same order
+         and carry the id of their request
+*/
+class LevProtocol
+  {
+   public: // Types
+      /// What a request asks for every lookup word
+      enum Op
+      {
+          CHECK   = 1,  ///< the word itself with distance 0 if it is in the dictionary, else nothing
+          MATCH   = 2,  ///< all words within distance k, the first limit ones if limit is not 0
+          CLOSEST = 3   ///< the words with the smallest distance up to k
+      };
+
+      /// Whether the server could answer a request
+      enum Status
+      {
+          OK        = 0,
+          INVALID   = 1,    ///< the request is malformed or asks for an unknown op, mode or a too large k
+          TOO_LARGE = 2     ///< the frame is larger than MAX_FRAME, the server closes the connection
+      };
+
+      /// Bits of the flags of a request
+      enum Flags
+      {
+          DAMERAU = 1,  ///< a transposition of two adjacent symbols is one edit
+          UTF8    = 2   ///< the symbols are the codepoints of UTF-8 encoded words
+      };
+
+      enum { HEADER = 4 };                  ///< the size field in front of every frame
+      enum { MAX_FRAME = 16 << 20 };        ///< the largest frame without its size field
+
+      struct Request
+      {
+          std::uint32_t             id;     ///< chosen by the client
+          unsigned                  op;
+          unsigned                  k;
+          unsigned                  flags;
+          unsigned                  mode;   ///< a LevenshteinAutomaton::Mode
+          std::uint32_t             limit;
+          std::vector<std::string>  words;
+      };
+
+      struct Match
+      {
+          std::string               word;
+          unsigned                  distance;
+      };
+
+      struct Response
+      {
+          std::uint32_t                     id;
+          unsigned                          status;
+          std::uint32_t                     latency;    ///< from reading the request to having its answer, in microseconds
+          std::vector<std::vector<Match>>   results;    ///< the matches of every lookup word, in order
+      };
+
+
+   public: // Functions
+    /**
+      @brief Tells whether a buffer starts with a complete frame
+      @param data, the received bytes
+      @param size, their number
+      @return The size of the first frame including its size field, 0 if it is incomplete
+    */
+    static std::size_t frame(const char* data, const std::size_t& size)
+    {
+        if (size < HEADER) { return 0; }
+
+        std::size_t length = HEADER + get32(data);
+        return size >= length ? length : 0;
+
+    } // frame
+
+    /**
+      @brief Returns the size a frame announces without its size field, to reject frames larger than MAX_FRAME early
+      @param data, at least HEADER received bytes
+    */
+    static std::uint32_t announced(const char* data)
+    {
+        return get32(data);
+
+    } // announced
+
+    /**
+      @brief Appends a request as a frame
+      @param request, the request
+      @param out, receives the frame
+    */
+    static void encode(const Request& request, std::string& out)
+    {
+        std::size_t start = out.size();
+        put32(out, 0);
+        put32(out, request.id);
+        out += static_cast<char>(request.op);
+        out += static_cast<char>(request.k);
+        out += static_cast<char>(request.flags);
+        out += static_cast<char>(request.mode);
+        put32(out, request.limit);
+        put32(out, request.words.size());
+        for (auto& word: request.words) {
+            put16(out, word.size());
+            out += word;
+        }
+        set32(out, start, out.size() - start - HEADER);
+
+    } // encode
+
+    /**
+      @brief Appends a response as a frame
+      @param response, the response
+      @param out, receives the frame
+    */
+    static void encode(const Response& response, std::string& out)
+    {
+        std::size_t start = out.size();
+        put32(out, 0);
+        put32(out, response.id);
+        out += static_cast<char>(response.status);
+        out.append(3, '\0');
+        put32(out, response.latency);
+        put32(out, response.results.size());
+        for (auto& matches: response.results) {
+            put32(out, matches.size());
+            for (auto& m: matches) {
+                out += static_cast<char>(m.distance);
+                put16(out, m.word.size());
+                out += m.word;
+            }
+        }
+        set32(out, start, out.size() - start - HEADER);
+
+    } // encode
+
+    /**
+      @brief Reads a request from a complete frame
+      @param data, the frame including its size field
+      @param size, the size returned by frame()
+      @param request, receives the request; its id is set as soon as it could be read
+      @return true iff the frame is a well-formed request
+    */
+    static bool decode(const char* data, const std::size_t& size, Request& request)
+    {
+        Reader in = {data + HEADER, data + size};
+        request.id = 0;
+        request.words.clear();
+        if (in.left() < 16) { return false; }
+
+        request.id = in.u32();
+        request.op = in.u8();
+        request.k = in.u8();
+        request.flags = in.u8();
+        request.mode = in.u8();
+        request.limit = in.u32();
+        std::uint32_t count = in.u32();
+
+        for (std::uint32_t q = 0; q < count; q++) {
+            if (in.left() < 2) { return false; }
+            std::size_t length = in.u16();
+            if (in.left() < length) { return false; }
+            request.words.push_back(in.bytes(length));
+        }
+
+        return in.left() == 0;
+
+    } // decode
+
+    /**
+      @brief Reads a response from a complete frame
+      @param data, the frame including its size field
+      @param size, the size returned by frame()
+      @param response, receives the response
+      @return true iff the frame is a well-formed response
+    */
+    static bool decode(const char* data, const std::size_t& size, Response& response)
+    {
+        Reader in = {data + HEADER, data + size};
+        response.results.clear();
+        if (in.left() < 16) { return false; }
+
+        response.id = in.u32();
+        response.status = in.u8();
+        in.bytes(3);
+        response.latency = in.u32();
+        std::uint32_t count = in.u32();
+
+        for (std::uint32_t q = 0; q < count; q++) {
+            if (in.left() < 4) { return false; }
+            std::uint32_t matches = in.u32();
+            response.results.push_back(std::vector<Match>());
+            for (std::uint32_t i = 0; i < matches; i++) {
+                if (in.left() < 3) { return false; }
+                Match m;
+                m.distance = in.u8();
+                std::size_t length = in.u16();
+                if (in.left() < length) { return false; }
+                m.word = in.bytes(length);
+                response.results.back().push_back(m);
+            }
+        }
+
+        return in.left() == 0;
+
+    } // decode
+
+
+   private: // Types
+      /// Reads the fields of a frame in order; the caller checks left() before every read
+      struct Reader
+      {
+          const char*   pos;
+          const char*   end;
+
+          std::size_t left() const { return end - pos; }
+
+          unsigned u8()
+          {
+              return static_cast<unsigned char>(*pos++);
+          }
+
+          unsigned u16()
+          {
+              unsigned v = u8();
+              return v | (u8() << 8);
+          }
+
+          std::uint32_t u32()
+          {
+              std::uint32_t v = get32(pos);
+              pos += 4;
+              return v;
+          }
+
+          std::string bytes(const std::size_t& n)
+          {
+              std::string s(pos, n);
+              pos += n;
+              return s;
+          }
+      };
+
+
+   private: // Functions
+    static std::uint32_t get32(const char* p)
+    {
+        const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+        return b[0] | (b[1] << 8) | (b[2] << 16) | (std::uint32_t(b[3]) << 24);
+
+    } // get32
+
+    static void put16(std::string& out, const std::size_t& v)
+    {
+        out += static_cast<char>(v & 0xFF);
+        out += static_cast<char>((v >> 8) & 0xFF);
+
+    } // put16
+
+    static void put32(std::string& out, const std::size_t& v)
+    {
+        put16(out, v & 0xFFFF);
+        put16(out, (v >> 16) & 0xFFFF);
+
+    } // put32
+
+    static void set32(std::string& out, const std::size_t& at, const std::size_t& v)
+    {
+        for (unsigned i = 0; i < 4; i++) { out[at + i] = static_cast<char>((v >> (8 * i)) & 0xFF); }
+
+    } // set32
+
+  }; // LevProtocol
+
+#endif // LEVPROTOCOL_HPP_INCLUDED
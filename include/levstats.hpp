@@ -0,0 +1,262 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Optional counters and timers of the automata, compiled in with LEV_ENABLE_STATS
+*/
+
+#ifndef LEVSTATS_HPP_INCLUDED
+#define LEVSTATS_HPP_INCLUDED
+
+// 1 compiles the statistics in; with 0 every LEV_COUNT and LEV_PHASE is an empty statement
+#ifndef LEV_ENABLE_STATS
+#define LEV_ENABLE_STATS 0
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+/// What the automata did, either for one thread so far or for one lookup
+struct LevCounters
+{
+    unsigned long long  nfa_states;     ///< NFA states numbered by subset constructions
+    unsigned long long  dfa_states;     ///< DFA states built by subset constructions, eager or lazy
+    unsigned long long  next_valid;     ///< calls of next_valid
+    unsigned long long  backtracks;     ///< steps back from a dead end in next_valid
+    unsigned long long  corpus_probes;  ///< next_in_corpus lookups and corpus words compared one by one
+    unsigned long long  index_edges;    ///< index edges followed in a lockstep walk
+    unsigned long long  matches;        ///< words handed to the caller
+};
+
+/// The statistics of one LevenshteinAutomaton, summed over all its lookups
+struct QueryStats
+{
+    LevCounters     counters;
+    double          nfa_us;             ///< building the NFA
+    double          determinize_us;     ///< the subset construction of the CompiledDFA
+    double          traverse_us;        ///< searching the corpus, including lazy determinization
+};
+
+/**
+  @brief LevStats collects the counters of every thread and histograms of every lookup phase of the process
+         The hot paths only add to counters of their own thread; whenever a phase ends, what it counted
+         is added to the statistics of its automaton and to the totals of the process
+         The totals and histograms can be written in the Prometheus text format at any time by any thread
+         Work done by the threads of a WorkStealingPool is handed back to the thread that started it
+*/
+class LevStats
+  {
+   public: // Types
+      /// The phases of a lookup
+      enum Phase { NFA, DETERMINIZE, TRAVERSE };
+
+      /// Histograms besides the time of every phase
+      enum Metric { NFA_US, DETERMINIZE_US, TRAVERSE_US, DFA_STATES, MATCHES, METRICS };
+
+      enum { BUCKETS = 32 };    ///< bucket b counts the values up to 2^b, the last one all larger ones
+      enum { COUNTERS = 7 };    ///< the counters of LevCounters
+
+      /**
+        @brief Measures a phase from its construction to its destruction
+      */
+      class PhaseTimer
+      {
+         public:
+          PhaseTimer(const Phase& phase, QueryStats& stats)
+              : phase(phase), stats(stats), before(local()), start(std::chrono::steady_clock::now())
+          {}
+
+          ~PhaseTimer()
+          {
+              double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+              LevCounters counted = difference(local(), before);
+              add(stats.counters, counted);
+              if (phase == NFA) { stats.nfa_us += us; }
+              if (phase == DETERMINIZE) { stats.determinize_us += us; }
+              if (phase == TRAVERSE) { stats.traverse_us += us; }
+
+              global().finish(phase, us, counted);
+          }
+
+         private:
+          Phase                                 phase;
+          QueryStats&                           stats;
+          LevCounters                           before;     ///< the counters of the thread at the start
+          std::chrono::steady_clock::time_point start;
+      };
+
+      /**
+        @brief Moves what the calling thread counts during its lifetime into the given counters,
+               so that work done on another thread can be handed back to the one measuring the phase
+      */
+      class Handoff
+      {
+         public:
+          explicit Handoff(LevCounters& into)
+              : into(into), before(local())
+          {}
+
+          ~Handoff()
+          {
+              into = difference(local(), before);
+              local() = before;
+          }
+
+         private:
+          LevCounters&  into;
+          LevCounters   before;
+      };
+
+
+   public: // Functions
+    /**
+      @brief Returns the counters of the calling thread, which the hot paths add to
+    */
+    static LevCounters& local()
+    {
+        static thread_local LevCounters counters = {0, 0, 0, 0, 0, 0, 0};
+        return counters;
+
+    } // local
+
+    /**
+      @brief Returns the statistics of the process
+    */
+    static LevStats& global()
+    {
+        static LevStats stats;
+        return stats;
+
+    } // global
+
+    /**
+      @brief Writes the totals and histograms in the Prometheus text format
+      @param out, the stream
+    */
+    void write(std::ostream& out) const
+    {
+        static const char* const counters[] = {
+            "nfa_states", "dfa_states", "next_valid", "backtracks", "corpus_probes", "index_edges", "matches"
+        };
+        static const char* const metrics[] = {
+            "nfa_us", "determinize_us", "traverse_us", "dfa_states_per_lookup", "matches_per_lookup"
+        };
+
+        for (unsigned c = 0; c < sizeof(counters) / sizeof(counters[0]); c++) {
+            out << "# TYPE lev_" << counters[c] << "_total counter\n";
+            out << "lev_" << counters[c] << "_total " << totals[c].load() << "\n";
+        }
+
+        for (unsigned m = 0; m < METRICS; m++) {
+            out << "# TYPE lev_" << metrics[m] << " histogram\n";
+            unsigned long long cumulative = 0;
+            for (unsigned b = 0; b < BUCKETS; b++) {
+                cumulative += buckets[m][b].load();
+                out << "lev_" << metrics[m] << "_bucket{le=\"";
+                if (b + 1 < BUCKETS) { out << (1ull << b); }
+                else { out << "+Inf"; }
+                out << "\"} " << cumulative << "\n";
+            }
+            out << "lev_" << metrics[m] << "_sum " << sums[m].load() << "\n";
+            out << "lev_" << metrics[m] << "_count " << cumulative << "\n";
+        }
+
+    } // write
+
+    /**
+      @brief Sets all totals and histograms to 0
+    */
+    void reset()
+    {
+        for (auto& total: totals) { total = 0; }
+        for (unsigned m = 0; m < METRICS; m++) {
+            sums[m] = 0;
+            for (auto& bucket: buckets[m]) { bucket = 0; }
+        }
+
+    } // reset
+
+    /**
+      @brief Adds the counters b to a
+    */
+    static void add(LevCounters& a, const LevCounters& b)
+    {
+        a.nfa_states += b.nfa_states;
+        a.dfa_states += b.dfa_states;
+        a.next_valid += b.next_valid;
+        a.backtracks += b.backtracks;
+        a.corpus_probes += b.corpus_probes;
+        a.index_edges += b.index_edges;
+        a.matches += b.matches;
+
+    } // add
+
+
+   private: // Functions
+    LevStats()
+    {
+        reset();
+    }
+
+    /**
+      @brief Adds the end of a phase to the totals and histograms
+    */
+    void finish(const Phase& phase, const double& us, const LevCounters& counted)
+    {
+        const unsigned long long values[COUNTERS] = {counted.nfa_states, counted.dfa_states, counted.next_valid,
+                                                     counted.backtracks, counted.corpus_probes,
+                                                     counted.index_edges, counted.matches};
+        for (unsigned c = 0; c < COUNTERS; c++) {
+            if (values[c] > 0) { totals[c] += values[c]; }
+        }
+
+        observe(static_cast<Metric>(NFA_US + phase), static_cast<unsigned long long>(us));
+        if (phase == DETERMINIZE) { observe(DFA_STATES, counted.dfa_states); }
+        if (phase == TRAVERSE) { observe(MATCHES, counted.matches); }
+
+    } // finish
+
+    /**
+      @brief Adds a value to a histogram
+    */
+    void observe(const Metric& metric, const unsigned long long& value)
+    {
+        unsigned b = 0;
+        while (b + 1 < BUCKETS && (1ull << b) < value) { b++; }
+        buckets[metric][b]++;
+        sums[metric] += value;
+
+    } // observe
+
+    /**
+      @brief The counters of a that are not yet in b
+    */
+    static LevCounters difference(const LevCounters& a, const LevCounters& b)
+    {
+        LevCounters d = {a.nfa_states - b.nfa_states, a.dfa_states - b.dfa_states, a.next_valid - b.next_valid,
+                         a.backtracks - b.backtracks, a.corpus_probes - b.corpus_probes,
+                         a.index_edges - b.index_edges, a.matches - b.matches};
+        return d;
+
+    } // difference
+
+
+   private: // variables
+      std::atomic<unsigned long long>   totals[COUNTERS];           ///< the counters of all finished phases
+      std::atomic<unsigned long long>   buckets[METRICS][BUCKETS];  ///< the histograms
+      std::atomic<unsigned long long>   sums[METRICS];              ///< the sum of the values of every histogram
+
+  }; // LevStats
+
+#if LEV_ENABLE_STATS
+#define LEV_COUNT(counter, n)       (LevStats::local().counter += (n))
+#define LEV_PHASE(phase, stats)     LevStats::PhaseTimer lev_phase_timer(LevStats::phase, stats)
+#else
+#define LEV_COUNT(counter, n)       ((void)0)
+#define LEV_PHASE(phase, stats)     ((void)0)
+#endif
+
+#endif // LEVSTATS_HPP_INCLUDED
@@ -0,0 +1,123 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Read-only view of a whole file, memory mapped where the platform allows it
+*/
+
+#ifndef MAPPEDFILE_HPP_INCLUDED
+#define MAPPEDFILE_HPP_INCLUDED
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+  @brief MappedFile makes the contents of a file available as one block of memory
+         On POSIX systems the file is mapped, so nothing is read before it is used
+         and the pages are shared by every process mapping the same file
+         Elsewhere the file is read into memory once
+*/
+class MappedFile
+  {
+   public: // Functions
+    /**
+      @brief Opens a file; is_open() tells whether this worked
+      @param path, the name of the file
+    */
+    MappedFile(const std::string& path)
+    {
+        bytes = 0;
+        length = 0;
+
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) { return; }
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* address = ::mmap(0, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (address != MAP_FAILED) {
+                bytes = static_cast<const char*>(address);
+                length = info.st_size;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (in.good() == false) { return; }
+
+        std::streamoff end = in.tellg();
+        if (end <= 0) { return; }
+
+        // Read into 64 bit words, so the data is aligned like a mapping
+        buffer.resize((end + 7) / 8);
+        in.seekg(0);
+        if (in.read(reinterpret_cast<char*>(buffer.data()), end).good() == true) {
+            bytes = reinterpret_cast<const char*>(buffer.data());
+            length = end;
+        }
+#endif
+    }
+
+    /// The mapping belongs to exactly one object
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+      @brief Destructor, unmaps the file
+    */
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (bytes != 0) { ::munmap(const_cast<char*>(bytes), length); }
+#endif
+    }
+
+    /**
+      @brief Tests whether the file could be opened and is not empty
+    */
+    bool is_open() const
+    {
+        return bytes != 0;
+
+    } // is_open
+
+    /**
+      @brief Returns the contents of the file
+    */
+    const char* data() const
+    {
+        return bytes;
+
+    } // data
+
+    /**
+      @brief Returns the size of the file in bytes
+    */
+    std::size_t size() const
+    {
+        return length;
+
+    } // size
+
+
+   private: // variables
+      const char*                   bytes;  ///< the first byte of the file
+      std::size_t                   length; ///< the size of the file
+      std::vector<unsigned long long> buffer; ///< the contents, if the file could not be mapped
+
+  }; // MappedFile
+
+#endif // MAPPEDFILE_HPP_INCLUDED
@@ -0,0 +1,103 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Resumable search for the next word a deterministic automaton accepts
+*/
+
+#ifndef NEXTVALID_HPP_INCLUDED
+#define NEXTVALID_HPP_INCLUDED
+
+#define NUL       '\0'
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "levstats.hpp"
+
+/**
+  @brief Searches an automaton for the next valid Word given an input Word, i.e. the smallest accepted word
+         that is not smaller than the input
+         Uses the given buffers only, so it does not allocate once they are large enough;
+         they keep the path of the previous call, which is only walked back to where the input leaves it
+         An edge that leads into the dead state is skipped, so an automaton may announce edges it cannot take
+  @param automaton, a CompiledDFA, ParametricAutomaton or LazyDFA; it needs start, is_dead, is_final,
+         next_state and find_next_edge
+  @param input, a Word
+  @param result, the previous result or empty, receives the next valid Word from this one
+  @param stack, the states along the previous result or empty, receives the states along the new one
+  @return true iff there is a next valid Word
+*/
+template<class Automaton>
+bool next_valid(const Automaton& automaton, const std::string& input, std::string& result,
+                std::vector<typename Automaton::State>& stack)
+{
+    typedef typename Automaton::State State;
+
+    LEV_COUNT(next_valid, 1);
+    if (automaton.is_dead(automaton.start()) == true) { return false; }
+
+    // Keep the states of the previous result as far as the input starts with it, stack[i] is the state after i characters
+    if (stack.empty() == true) {
+        result.clear();
+        stack.push_back(automaton.start());
+    }
+    std::size_t i = 0;
+    while (i < result.size() && i < input.size() && result[i] == input[i]) { i++; }
+    result.resize(i);
+    stack.erase(stack.begin() + i + 1, stack.end());
+
+    // Follow the rest of the input as far as possible
+    State state = stack.back();
+    for (; i < input.size(); i++) {
+        state = automaton.next_state(state, input[i]);
+        if (automaton.is_dead(state) == true) { break; }
+
+        stack.push_back(state);
+        result.push_back(input[i]);
+    }
+
+    // If the whole input was read and ends in a final state, it is already valid
+    int first = NUL;
+    if (i == input.size()) {
+        if (automaton.is_final(state) == true) { return true; }
+    }
+    else {
+        first = static_cast<unsigned char>(input[i]) + 1;
+    }
+
+    // Depth first search for the smallest extension, backtracking to larger edges
+    while (true) {
+        int x = automaton.find_next_edge(stack.back(), first);
+
+        if (x < 0) {
+            if (result.empty() == true) { return false; }
+
+            LEV_COUNT(backtracks, 1);
+
+            first = static_cast<unsigned char>(result.back()) + 1;
+            result.pop_back();
+            stack.pop_back();
+            continue;
+        }
+
+        state = automaton.next_state(stack.back(), x);
+        if (automaton.is_dead(state) == true) {
+            first = x + 1;
+            continue;
+        }
+
+        result.push_back(static_cast<char>(x));
+        stack.push_back(state);
+
+        if (automaton.is_final(state) == true) { return true; }
+
+        first = NUL;
+    } // while
+
+} // next_valid
+
+#endif // NEXTVALID_HPP_INCLUDED
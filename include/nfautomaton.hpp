@@ -1,26 +1,33 @@
 /*
-Lisanne Wiengarten
-Matrikelnr. 764870
+Lisanne Wiengarten
+Matrikelnr. 764870
 EAIDCL WiSe13/14
 gcc 4.9.1 C++11 Win10
 
 Compact representation of a nondeterministic final automaton
 */
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include "dfautomaton.hpp"
+#include "compileddfa.hpp"
+#include "label.hpp"
+#include "levstats.hpp"
+#include "utf8.hpp"
 
 #ifndef NFAUTOMATON_HPP_INCLUDED
 #define NFAUTOMATON_HPP_INCLUDED
-
-#define ANY       "ANY"
-#define EPSILON   "EPSILON"
+
 #define NONE      "\0"
-#define NUL       "-"
+#define NUL       '\0'
 
-/**
+/**
   @brief NFAutomaton is a class for representing
          standard nondeterministic final automata
-         Includes a function to transform it into its deterministic version (DFAutomaton)
+         Includes a function to transform it into its deterministic version (DFAutomaton)
 */
 class NFAutomaton
 {
@@ -32,12 +39,45 @@ class NFAutomaton
    private: // Types
       typedef std::string                       Word;
       typedef std::vector<Word>                 WordVec;
-      typedef std::map<Word, Stateset>          WordStatesetMap;
+      typedef std::vector<Label>                LabelVec;
+      typedef std::map<Label, Stateset>         LabelStatesetMap;
+
+      /// A transition of the NFA in the flat form of the subset construction, states are numbered
+      struct Edge
+      {
+          Label         input;
+          unsigned      target;
+      };
+
+      /**
+        Scratch memory of the subset construction
+        A set of NFA states is a bitset of fixed width in one pool instead of a std::set, so finality,
+        errors and epsilon closures are ANDs and ORs of whole words, and known sets are found by a hash
+        All arrays are only cleared between constructions, so once they have grown to the size of a lookup,
+        later lookups on the same thread do not allocate for it at all
+      */
+      struct Workspace
+      {
+          std::vector<NState>           ids;        ///< the NFA states, sorted, numbered by their place
+          std::vector<unsigned>         first;      ///< the edges of state s are edges[first[s]] to edges[first[s+1]]
+          std::vector<Edge>             edges;      ///< all transitions but EPSILON, by state and input
+          std::vector<unsigned>         eps_first;  ///< the same for eps
+          std::vector<unsigned>         eps;        ///< the targets of the EPSILON transitions
+          std::size_t                   words;      ///< the 64 bit words of one set
+          std::vector<std::uint64_t>    closures;   ///< the epsilon closure of every NFA state
+          std::vector<std::uint64_t>    finals;     ///< the final states
+          std::vector<std::uint64_t>    levels;     ///< the states with e errors, for every e
+          std::vector<std::uint64_t>    pool;       ///< the sets one after the other, then the one being built
+          std::size_t                   sets;       ///< the number of sets in the pool
+          std::vector<unsigned>         table;      ///< open addressing table of set numbers + 1, 0 is free
+          std::vector<unsigned>         members;    ///< the NFA states of the current set
+          std::vector<Label>            inputs;     ///< the inputs of the current set
+      };
 
 
    public: // Functions
-    /**
-      @brief Default constructor
+    /**
+      @brief Default constructor
     */
     NFAutomaton() {
         startStates.insert(std::make_tuple(0, 0));
@@ -45,9 +85,9 @@ class NFAutomaton
     }
 
 
-    /**
-      @brief Constructor from start state
-      @param inputstate, the incoming state
+    /**
+      @brief Constructor from start state
+      @param inputstate, the incoming state
     */
     NFAutomaton(const NState& inputstate)
     {
@@ -55,21 +95,30 @@ class NFAutomaton
         expand(startStates);
     }
 
-    /**
+    /**
+      @brief Returns the expanded set of start states
+    */
+    Stateset start_states() const
+    {
+        return expand(startStates);
+
+    } // start_states
+
+    /**
       @brief Adds a transition from one state to another with a certain input
       @param NState src
-      @param Word input
-      @param NState dest
+      @param Label input
+      @param NState dest
     */
-    void add_transition(const NState& src, const Word& input, const NState& dest)
+    void add_transition(const NState& src, const Label& input, const NState& dest)
     {
         transitions[src][input].insert(dest);
 
     } // add_transition
 
-    /**
+    /**
       @brief Adds a final state to the automaton
-      @param NState state which will be added
+      @param NState state which will be added
     */
     void add_final_state(const NState& state)
     {
@@ -77,10 +126,10 @@ class NFAutomaton
 
     } // add_final_state
 
-    /**
-      @brief Tests whether a given state is among the final states
+    /**
+      @brief Tests whether a given state is among the final states
       @param NState state, the state to be tested
-      @return true iff the state is final
+      @return true iff the state is final
     */
     const bool is_final_state(const NState& state) const
     {
@@ -88,10 +137,10 @@ class NFAutomaton
 
     } // is_final
 
-    /**
-      @brief Tests whether a given set of states is among the final states
+    /**
+      @brief Tests whether a given set of states is among the final states
       @param Stateset states, the states to be tested
-      @return true iff the stateset contains one or more final states
+      @return true iff the stateset contains one or more final states
     */
     const bool contains_final_states(const Stateset& states) const
     {
@@ -103,12 +152,33 @@ class NFAutomaton
 
     } // contains_final_states
 
-    /**
-      @brief Expands a set of states
+    /**
+      @brief Counts the errors of a set of states of the Levenshtein NFA,
+             where the second component of an NState is the number of errors so far
       @param states, a set of NStates
-      @return the expanded set of NStates
+      @param distance, receives the fewest errors of a final state in the set
+      @param bound, receives the fewest errors of any state in the set, which no continuation can undercut
     */
-    Stateset expand(Stateset states)
+    void count_errors(const Stateset& states, unsigned& distance, unsigned& bound) const
+    {
+        distance = std::numeric_limits<unsigned char>::max();
+        bound = distance;
+        for (auto state: states) {
+            unsigned errors = std::get<1>(state);
+            bound = std::min(bound, errors);
+            if (is_final_state(state) == true) {
+                distance = std::min(distance, errors);
+            }
+        }
+
+    } // count_errors
+
+    /**
+      @brief Expands a set of states
+      @param states, a set of NStates
+      @return the expanded set of NStates
+    */
+    Stateset expand(Stateset states) const
     {
         std::deque<NState> state_queue(states.begin(), states.end());
 
@@ -118,19 +188,15 @@ class NFAutomaton
             NState current = state_queue[0];
             state_queue.pop_front();
 
-            WordStatesetMap current_map;
-            if (transitions.count(current) == 1) {
-                current_map = transitions.at(current);
-            }
+            auto pos = transitions.find(current);
+            if (pos == transitions.end()) { continue; }
 
-            Stateset newstates;
-            if (current_map.count(EPSILON) == 1) {
-                Stateset current_states(current_map.at(EPSILON));
-                std::set_difference(current_states.begin(), current_states.end(), states.begin(), states.end(), std::inserter(newstates, newstates.end()));
+            auto epsilon = pos->second.find(Label::epsilon());
+            if (epsilon == pos->second.end()) { continue; }
 
-                for (auto newstate: newstates) {
+            for (auto newstate: epsilon->second) {
+                if (states.insert(newstate).second == true) {
                     state_queue.push_back(newstate);
-                    states.insert(newstate);
                 }
             }
         }
@@ -139,49 +205,52 @@ class NFAutomaton
 
     } // expand
 
-    /**
-      @brief Looks for the next reachable state from a given set of states and an input word
+    /**
+      @brief Looks for the next reachable state from a given set of states and an input label
       @param states, a set of NStates
-      @param input, a Word
-      @return The set of states reachable from this set of states with this input
+      @param input, a Label
+      @return The set of states reachable from this set of states with this input
     */
-    Stateset next_states(Stateset states, Word input)
+    Stateset next_states(const Stateset& states, const Label& input) const
     {
         // The returned set of states contains all the states that can be reached
         // with the given input, the ANY symbol or EPSILON (by expanding the set in the last step)
         Stateset destinations;
-        for (auto state: states) {
-            if (transitions.count(state) == 1) {
-
-                if (transitions[state].count(input) == 1) {
-                    destinations.insert(transitions[state][input].begin(), transitions[state][input].end());
-                }
+        for (auto& state: states) {
+            auto pos = transitions.find(state);
+            if (pos == transitions.end()) { continue; }
+
+            const LabelStatesetMap& current_map = pos->second;
+            auto edge = current_map.find(input);
+            if (edge != current_map.end()) {
+                destinations.insert(edge->second.begin(), edge->second.end());
+            }
 
-                if (transitions[state].count(ANY) == 1) {
-                    destinations.insert(transitions[state][ANY].begin(), transitions[state][ANY].end());
-                }
-             }
-          }
+            edge = current_map.find(Label::any());
+            if (edge != current_map.end()) {
+                destinations.insert(edge->second.begin(), edge->second.end());
+            }
+        }
 
         return expand(destinations);
 
     } // next_states
 
-    /**
-      @brief Retrieves all possible inputs for a given set of states
+    /**
+      @brief Retrieves all possible inputs for a given set of states
       @param states, a set of NStates
-      @return The set of inputs valid for these states
+      @return The set of inputs valid for these states
     */
-    WordVec get_inputs(Stateset states)
+    LabelVec get_inputs(const Stateset& states) const
     {
-        WordVec inputs;
-        // Looks up every Word stored together with the given states in the map of transitions
+        LabelVec inputs;
+        // Looks up every Label stored together with the given states in the map of transitions
         for (auto i = states.begin(); i != states.end(); i++) {
-            if (transitions.count(*i) == 1) {
+            auto pos = transitions.find(*i);
+            if (pos == transitions.end()) { continue; }
 
-                for (auto j = transitions[*i].begin(); j != transitions[*i].end(); j++) {
-                    inputs.push_back(j->first);
-                }
+            for (auto j = pos->second.begin(); j != pos->second.end(); j++) {
+                inputs.push_back(j->first);
             }
         }
 
@@ -190,59 +259,85 @@ class NFAutomaton
     } // get_inputs
 
 
-    /**
+    /**
       @brief Converts the whole NFA into its deterministic version
-      @return An equivalent DFA
+      @return An equivalent DFA
     */
-    DFA to_dfa()
+    DFA to_dfa() const
     {
         DFAutomaton dfa(expand(startStates));
 
-        std::deque<Stateset> current_states;
-        current_states.push_back(expand(startStates));
-        std::set<Stateset> seen_states;
-
-        while (current_states.size() > 0) {
-            Stateset current = current_states[0];
-            current_states.pop_front();
+        // A set of NStates represents one single state in the DFA
+        // if it contains at least one final state from the NFA, it becomes final in the DFA
+        determinize(
+            [&](const Workspace& w, const std::size_t& id, const bool& final, const unsigned&, const unsigned&) {
+                if (final == true) { dfa.add_final_state(stateset(w, id)); }
+            },
+            [&](const Workspace& w, const std::size_t& id, const Label& input, const std::size_t& target) {
+                // If the current input is the nondeterministic ANY symbol *, a default transition is added to the DFA
+                if (input == Label::any()) {
+                    dfa.set_default_transition(stateset(w, id), stateset(w, target));
+                }
+                else {
+                    dfa.add_transition(stateset(w, id), input, stateset(w, target));
+                }
+            });
 
-            // Get every valid Word for the current state
-            WordVec inputs = get_inputs(current);
+        return dfa;
 
-            for (auto input: inputs) {
-                if (input == EPSILON) { continue; }
+    } // to_dfa
 
-                // Get every state that is reachable from the current state with the current input
-                // A set of NStates represents one single state in the DFA
-                Stateset new_state = next_states(current, input);
+    /**
+      @brief Converts the whole NFA into the flat CompiledDFA form without building a DFAutomaton
+             State ids are handed out in the order the states are discovered
+      @return An equivalent CompiledDFA
+    */
+    CompiledDFA to_compiled_dfa() const
+    {
+        CompiledDFA dfa;
+
+        determinize(
+            [&](const Workspace&, const std::size_t&, const bool& final, const unsigned& distance, const unsigned& bound) {
+                dfa.add_state(final, distance, bound);
+            },
+            [&](const Workspace&, const std::size_t& id, const Label& input, const std::size_t& target) {
+                if (input == Label::any()) {
+                    dfa.set_default_transition(id, target);
+                }
+                else {
+                    dfa.add_transition(input.value(), target);
+                }
+            });
 
-                // If we did not already see these new states, they are added to the queue
-                if (seen_states.find(new_state) == seen_states.end()) {
-                    current_states.push_back(new_state);
-                    seen_states.insert(new_state);
+        return dfa;
 
-                    // new_state represents one single state from the new DFA
-                    // if it contains at least one final state from the NFA, it becomes final in the DFA
-                    if (contains_final_states(new_state)) {
-                        dfa.add_final_state(new_state);
-                    }
-                }
+    } // to_compiled_dfa
 
-                // If the current input is the nondeterministic ANY symbol *, a default transition is added to the DFA
-                if (input.compare(ANY) == 0) {
-                    dfa.set_default_transition(current, new_state);
+    /**
+      @brief Converts an NFA whose symbols are codepoints into a CompiledDFA over their UTF-8 bytes
+             ANY stands for any codepoint, see Utf8Compiler
+      @return An equivalent CompiledDFA for UTF-8 encoded words
+    */
+    CompiledDFA to_utf8_dfa() const
+    {
+        Utf8Compiler compiler;
+
+        determinize(
+            [&](const Workspace&, const std::size_t&, const bool& final, const unsigned& distance, const unsigned& bound) {
+                compiler.add_state(final, distance, bound);
+            },
+            [&](const Workspace&, const std::size_t& id, const Label& input, const std::size_t& target) {
+                if (input == Label::any()) {
+                    compiler.set_default_transition(id, target);
                 }
-
                 else {
-                    dfa.add_transition(current, input, new_state);
+                    compiler.add_transition(id, input.value(), target);
                 }
+            });
 
-            } // for inputs
-        } // while
+        return compiler.compile();
 
-        return dfa;
-
-    } // to_dfa
+    } // to_utf8_dfa
 
     /**
         @brief Prints the whole automaton in a readable way
@@ -265,13 +360,13 @@ class NFAutomaton
     /**
         @brief Prints a dot representation of the NFA to stream 'out'
         @param ostream out
-    */
-    void nfa_to_dot(std::ostream& out) const
-    {
+    */
+    void nfa_to_dot(std::ostream& out) const
+    {
 
-        out << "digraph FSM {" << std::endl;
+        out << "digraph FSM {" << std::endl;
         out << "graph [rankdir=LR, fontsize=14, center=1, orientation=Portrait];" << std::endl;
-        out << "node  [font = \"Arial\", shape = circle, style=filled, fontcolor=black, color=lightgray]" << std::endl;
+        out << "node  [font = \"Arial\", shape = circle, style=filled, fontcolor=black, color=lightgray]" << std::endl;
         out << "edge  [fontname = \"Arial\"]" << std::endl << std::endl;
 
         for (auto i = transitions.begin(); i != transitions.end(); i++) {
@@ -288,7 +383,7 @@ class NFAutomaton
             }
         }
         out << "}" << std::endl;
-
+
     } // nfa_to_dot
 
 
@@ -311,9 +406,289 @@ class NFAutomaton
     } // nstate_to_string
 
 
+   private: // Functions
+    /**
+      @brief Returns the Workspace of the calling thread, which is reused by all its constructions
+    */
+    static Workspace& workspace()
+    {
+        static thread_local Workspace w;
+        return w;
+
+    } // workspace
+
+    /**
+      @brief Does the subset construction in the Workspace of the calling thread
+             The sets of NFA states are numbered in the order they are discovered, starting with the start set
+      @param add_state, is called with the Workspace, the number of every set, whether it is final,
+             its distance and the bound of its distances, in the order of the numbers
+      @param add_edge, is called with the Workspace, the number of a set, an input other than EPSILON
+             and the number of the set reached with it, sorted by input for every set
+    */
+    template<class AddState, class AddEdge>
+    void determinize(AddState add_state, AddEdge add_edge) const
+    {
+        Workspace& w = workspace();
+        flatten(w);
+
+        begin_set(w);
+        for (auto& state: startStates) {
+            add_closure(w, number(w, state));
+        }
+        close_set(w);
+
+        const std::size_t levels = w.levels.size() / w.words;
+        for (std::size_t id = 0; id < w.sets; id++) {
+            // The pool grows below, so the current set is addressed by its position only
+            const std::size_t set = id * w.words;
+
+            bool final = false;
+            unsigned distance = std::numeric_limits<unsigned char>::max();
+            unsigned bound = distance;
+            for (std::size_t i = 0; i < w.words; i++) {
+                final = final || (w.pool[set + i] & w.finals[i]) != 0;
+            }
+            for (std::size_t e = levels; e-- > 0; ) {
+                for (std::size_t i = 0; i < w.words; i++) {
+                    std::uint64_t level = w.pool[set + i] & w.levels[e * w.words + i];
+                    if (level != 0) { bound = e; }
+                    if ((level & w.finals[i]) != 0) { distance = e; }
+                }
+            }
+            add_state(w, id, final, distance, bound);
+
+            // Every valid Label for the current set, sorted so that the edges are added in order
+            w.members.clear();
+            w.inputs.clear();
+            for (std::size_t i = 0; i < w.words; i++) {
+                for (std::uint64_t bits = w.pool[set + i]; bits != 0; bits &= bits - 1) {
+                    unsigned s = i * 64 + lowest_bit(bits);
+                    w.members.push_back(s);
+                    for (unsigned e = w.first[s]; e < w.first[s + 1]; e++) {
+                        w.inputs.push_back(w.edges[e].input);
+                    }
+                }
+            }
+            std::sort(w.inputs.begin(), w.inputs.end());
+            w.inputs.erase(std::unique(w.inputs.begin(), w.inputs.end()), w.inputs.end());
+
+            for (std::size_t j = 0; j < w.inputs.size(); j++) {
+                const Label input = w.inputs[j];
+                begin_set(w);
+                for (auto s: w.members) {
+                    for (unsigned e = w.first[s]; e < w.first[s + 1]; e++) {
+                        if (w.edges[e].input == input || w.edges[e].input == Label::any()) {
+                            add_closure(w, w.edges[e].target);
+                        }
+                    }
+                }
+
+                // New sets of NStates get the next free number and are handled in a later iteration
+                add_edge(w, id, input, close_set(w));
+            }
+        } // for id
+
+    } // determinize
+
+    /**
+      @brief Numbers the states of the NFA, stores its transitions in flat arrays and its epsilon closures,
+             final states and errors as bitsets, and empties the sets of the previous construction
+      @param w, the Workspace
+    */
+    void flatten(Workspace& w) const
+    {
+        w.ids.clear();
+        for (auto& src: transitions) {
+            w.ids.push_back(src.first);
+            for (auto& edge: src.second) {
+                w.ids.insert(w.ids.end(), edge.second.begin(), edge.second.end());
+            }
+        }
+        w.ids.insert(w.ids.end(), startStates.begin(), startStates.end());
+        w.ids.insert(w.ids.end(), final_states.begin(), final_states.end());
+        std::sort(w.ids.begin(), w.ids.end());
+        w.ids.erase(std::unique(w.ids.begin(), w.ids.end()), w.ids.end());
+        LEV_COUNT(nfa_states, w.ids.size());
+
+        w.first.clear();
+        w.edges.clear();
+        w.eps_first.clear();
+        w.eps.clear();
+        w.words = (w.ids.size() + 63) / 64;
+        w.finals.assign(w.words, 0);
+        w.levels.clear();
+        for (unsigned s = 0; s < w.ids.size(); s++) {
+            w.first.push_back(w.edges.size());
+            w.eps_first.push_back(w.eps.size());
+
+            const std::uint64_t bit = std::uint64_t(1) << (s % 64);
+            if (is_final_state(w.ids[s]) == true) { w.finals[s / 64] |= bit; }
+
+            std::size_t errors = std::get<1>(w.ids[s]);
+            if (w.levels.size() <= errors * w.words) { w.levels.resize((errors + 1) * w.words, 0); }
+            w.levels[errors * w.words + s / 64] |= bit;
+
+            auto pos = transitions.find(w.ids[s]);
+            if (pos == transitions.end()) { continue; }
+
+            for (auto& edge: pos->second) {
+                for (auto& dest: edge.second) {
+                    if (edge.first == Label::epsilon()) {
+                        w.eps.push_back(number(w, dest));
+                    }
+                    else {
+                        Edge flat = {edge.first, number(w, dest)};
+                        w.edges.push_back(flat);
+                    }
+                }
+            }
+        }
+        w.first.push_back(w.edges.size());
+        w.eps_first.push_back(w.eps.size());
+
+        // The closure of a state is itself and everything reachable from it with EPSILON
+        w.closures.assign(w.ids.size() * w.words, 0);
+        for (unsigned s = 0; s < w.ids.size(); s++) {
+            std::uint64_t* closure = &w.closures[s * w.words];
+            closure[s / 64] |= std::uint64_t(1) << (s % 64);
+            w.members.assign(1, s);
+            while (w.members.empty() == false) {
+                unsigned u = w.members.back();
+                w.members.pop_back();
+                for (unsigned e = w.eps_first[u]; e < w.eps_first[u + 1]; e++) {
+                    unsigned v = w.eps[e];
+                    const std::uint64_t bit = std::uint64_t(1) << (v % 64);
+                    if ((closure[v / 64] & bit) == 0) {
+                        closure[v / 64] |= bit;
+                        w.members.push_back(v);
+                    }
+                }
+            }
+        }
+
+        w.pool.clear();
+        w.sets = 0;
+        w.table.assign(64, 0);
+
+    } // flatten
+
+    /**
+      @brief Returns the number of an NFA state in the Workspace
+    */
+    unsigned number(const Workspace& w, const NState& state) const
+    {
+        return std::lower_bound(w.ids.begin(), w.ids.end(), state) - w.ids.begin();
+
+    } // number
+
+    /**
+      @brief Starts an empty set at the end of the pool
+    */
+    static void begin_set(Workspace& w)
+    {
+        w.pool.resize((w.sets + 1) * w.words, 0);
+
+    } // begin_set
+
+    /**
+      @brief Adds an NFA state and its epsilon closure to the set being built
+    */
+    static void add_closure(Workspace& w, const unsigned& state)
+    {
+        std::uint64_t* set = &w.pool[w.sets * w.words];
+        const std::uint64_t* closure = &w.closures[state * w.words];
+        for (std::size_t i = 0; i < w.words; i++) {
+            set[i] |= closure[i];
+        }
+
+    } // add_closure
+
+    /**
+      @brief Keeps the set being built as a new set unless it is already known
+      @param w, the Workspace
+      @return The number of the set
+    */
+    static std::size_t close_set(Workspace& w)
+    {
+        const std::size_t begin = w.sets * w.words;
+
+        // Look the set up by its hash, a known one is dropped from the pool again
+        const std::size_t mask = w.table.size() - 1;
+        std::size_t slot = hash_set(w, w.sets) & mask;
+        while (w.table[slot] != 0) {
+            unsigned known = w.table[slot] - 1;
+            if (std::equal(w.pool.begin() + begin, w.pool.end(), w.pool.begin() + known * w.words) == true) {
+                w.pool.resize(begin);
+                return known;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        const std::size_t id = w.sets++;
+        LEV_COUNT(dfa_states, 1);
+        w.table[slot] = id + 1;
+
+        // Keep the table at most half full
+        if (w.sets * 2 > w.table.size()) {
+            w.table.assign(w.table.size() * 2, 0);
+            for (std::size_t d = 0; d < w.sets; d++) {
+                std::size_t free = hash_set(w, d) & (w.table.size() - 1);
+                while (w.table[free] != 0) { free = (free + 1) & (w.table.size() - 1); }
+                w.table[free] = d + 1;
+            }
+        }
+
+        return id;
+
+    } // close_set
+
+    /**
+      @brief Hashes the words of a set (FNV-1a)
+    */
+    static std::size_t hash_set(const Workspace& w, const std::size_t& id)
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (std::size_t i = id * w.words; i < (id + 1) * w.words; i++) {
+            h = (h ^ w.pool[i]) * 1099511628211ull;
+        }
+        return static_cast<std::size_t>(h ^ (h >> 32));
+
+    } // hash_set
+
+    /**
+      @brief Converts a set of the Workspace back into a Stateset
+    */
+    static Stateset stateset(const Workspace& w, const std::size_t& id)
+    {
+        Stateset states;
+        for (std::size_t i = 0; i < w.words; i++) {
+            for (std::uint64_t bits = w.pool[id * w.words + i]; bits != 0; bits &= bits - 1) {
+                states.insert(states.end(), w.ids[i * 64 + lowest_bit(bits)]);
+            }
+        }
+        return states;
+
+    } // stateset
+
+    /**
+      @brief Returns the position of the lowest set bit of a word that is not 0
+    */
+    static unsigned lowest_bit(const std::uint64_t& bits)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(bits);
+#else
+        unsigned position = 0;
+        while (((bits >> position) & 1) == 0) { position++; }
+        return position;
+#endif
+
+    } // lowest_bit
+
+
    private: // variables
       Stateset                          startStates;     ///< the automaton's start state
-      std::map<NState, WordStatesetMap> transitions;     ///< the map containing all transitions of the automaton
+      std::map<NState, LabelStatesetMap> transitions;     ///< the map containing all transitions of the automaton
       Stateset                          final_states;    ///< the set of final states
 
   }; // NFAutomaton
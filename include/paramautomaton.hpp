@@ -0,0 +1,494 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Universal (parametric) Levenshtein automata
+The transition tables only depend on k and are computed once,
+a lookup word is then applied to them through characteristic vectors
+*/
+
+#ifndef PARAMAUTOMATON_HPP_INCLUDED
+#define PARAMAUTOMATON_HPP_INCLUDED
+
+#define NONE      "\0"
+#define NUL       '\0'
+
+#define MAX_PARAMETRIC_DISTANCE 3
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "levstats.hpp"
+#include "nextvalid.hpp"
+
+/**
+  @brief UniversalTable holds the word independent transition table
+         of the Levenshtein automaton for one maximum distance k
+         A parametric state is a set of (offset, errors) positions relative to a base position,
+         a transition is chosen by the characteristic vector of the next 2k+2 characters of the word
+*/
+class UniversalTable
+  {
+   public: // Types
+      typedef std::pair<unsigned, unsigned>     Position;
+      typedef std::vector<Position>             PState;
+
+      /// One entry of the table: the reached parametric state and how far its base moves
+      struct Transition
+      {
+          unsigned short    next;
+          unsigned char     shift;
+      };
+
+   public: // Functions
+    /**
+      @brief Returns the table for distance k, building it on first use
+      @param k, the maximum edit distance (at most MAX_PARAMETRIC_DISTANCE)
+      @return The shared table for this k
+    */
+    static const UniversalTable& get(const unsigned& k)
+    {
+        static UniversalTable* tables[MAX_PARAMETRIC_DISTANCE + 1] = {};
+        static std::once_flag flags[MAX_PARAMETRIC_DISTANCE + 1];
+
+        std::call_once(flags[k], [k]() { tables[k] = new UniversalTable(k); });
+        return *tables[k];
+
+    } // get
+
+    /**
+      @brief Width of the characteristic vectors used by this table
+    */
+    unsigned width() const
+    {
+        return window;
+
+    } // width
+
+    /**
+      @brief Looks up the transition for a parametric state
+      @param state, the id of the parametric state
+      @param remaining, the number of word characters left from the base (cut off at width())
+      @param bits, the characteristic vector of the input character within these characters
+      @return The reached state (0 is the dead state) and the shift of its base
+    */
+    const Transition& next(const unsigned& state, const unsigned& remaining, const unsigned& bits) const
+    {
+        return table[(state * (window + 1) + remaining) * (1u << window) + bits];
+
+    } // next
+
+    /**
+      @brief Returns the edit distance a parametric state stands for at the end of the input
+      @param state, the id of the parametric state
+      @param remaining, the number of word characters left from the base (cut off at width())
+      @return The distance, or k+1 if the state is not final
+    */
+    unsigned distance(const unsigned& state, const unsigned& remaining) const
+    {
+        return distances[state * (window + 1) + remaining];
+
+    } // distance
+
+    /**
+      @brief Returns the fewest errors of any position of a parametric state,
+             a lower bound of every distance reachable from it
+      @param state, the id of the parametric state
+      @return The bound, k+1 for the dead state
+    */
+    unsigned bound(const unsigned& state) const
+    {
+        return bounds[state];
+
+    } // bound
+
+    /**
+      @brief Number of parametric states including the dead state
+    */
+    std::size_t size() const
+    {
+        return states.size();
+
+    } // size
+
+
+   private: // Functions
+    /**
+      @brief Computes all parametric states and their transitions for distance k
+      @param distance, the maximum edit distance
+    */
+    UniversalTable(const unsigned& distance)
+    {
+        k = distance;
+        window = 2 * k + 2;
+
+        // State 0 is the dead state, state 1 the start state {(0,0)}
+        intern(PState());
+        intern(PState(1, Position(0, 0)));
+
+        const unsigned vectors = 1u << window;
+        for (unsigned s = 0; s < states.size(); s++) {
+            for (unsigned r = 0; r <= window; r++) {
+                // Positions at or behind the end of the word can never match
+                for (unsigned bits = 0; bits < vectors; bits++) {
+                    Transition t = {0, 0};
+                    if (r == window || (bits >> r) == 0) {
+                        unsigned shift = 0;
+                        PState reached = step(states[s], r, bits, shift);
+                        t.next = static_cast<unsigned short>(intern(reached));
+                        t.shift = static_cast<unsigned char>(shift);
+                    }
+                    table.push_back(t);
+                }
+
+                distances.push_back(final_distance(states[s], r));
+            }
+
+            unsigned fewest = k + 1;
+            for (auto& p: states[s]) {
+                fewest = std::min(fewest, p.second);
+            }
+            bounds.push_back(fewest);
+        } // for s
+
+    } // UniversalTable
+
+    /**
+      @brief Returns the id of a parametric state, adding it if it is new
+      @param state, a normalized parametric state
+      @return The id of this state
+    */
+    unsigned intern(const PState& state)
+    {
+        auto pos = ids.find(state);
+        if (pos != ids.end()) { return pos->second; }
+
+        unsigned id = states.size();
+        ids[state] = id;
+        states.push_back(state);
+        return id;
+
+    } // intern
+
+    /**
+      @brief Computes the successor of a parametric state
+      @param state, the current parametric state
+      @param remaining, the word characters left from the base (width() means "at least")
+      @param bits, the characteristic vector of the input character
+      @param shift, receives how far the base of the new state moved
+      @return The normalized successor state
+    */
+    PState step(const PState& state, const unsigned& remaining, const unsigned& bits, unsigned& shift) const
+    {
+        PState reached;
+        for (auto p: state) {
+            unsigned d = p.first;
+            unsigned e = p.second;
+            bool in_word = d < remaining;
+
+            // Transition with the matching character of the word
+            if (in_word && (bits >> d & 1u)) {
+                reached.push_back(Position(d + 1, e));
+                continue;
+            }
+            if (e == k) { continue; }
+
+            // Transition for insertion and for substitution
+            reached.push_back(Position(d, e + 1));
+            if (in_word) { reached.push_back(Position(d + 1, e + 1)); }
+
+            // Transitions for deleting j characters of the word before a matching one
+            for (unsigned j = 1; j <= k - e; j++) {
+                if (d + j < remaining && (bits >> (d + j) & 1u)) {
+                    reached.push_back(Position(d + j + 1, e + j));
+                    break;
+                }
+            }
+        } // for state
+
+        reached = reduce(reached);
+
+        shift = 0;
+        if (reached.size() > 0) {
+            shift = reached[0].first;
+            for (auto& p: reached) {
+                shift = std::min(shift, p.first);
+            }
+            for (auto& p: reached) {
+                p.first -= shift;
+            }
+        }
+
+        return reached;
+
+    } // step
+
+    /**
+      @brief Removes all positions which are subsumed by another one
+             (j,f) subsumes (i,e) if f < e and |i-j| <= e-f
+      @param positions, a list of positions
+      @return The sorted list without duplicates and subsumed positions
+    */
+    static PState reduce(PState positions)
+    {
+        std::sort(positions.begin(), positions.end());
+        positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+        PState reduced;
+        for (auto p: positions) {
+            bool subsumed = false;
+            for (auto q: positions) {
+                int diff = static_cast<int>(p.first) - static_cast<int>(q.first);
+                if (q.second < p.second && std::abs(diff) <= static_cast<int>(p.second - q.second)) {
+                    subsumed = true;
+                    break;
+                }
+            }
+            if (subsumed == false) {
+                reduced.push_back(p);
+            }
+        }
+
+        return reduced;
+
+    } // reduce
+
+    /**
+      @brief Computes the edit distance of a state at the end of the input
+      @param state, a parametric state
+      @param remaining, the word characters left from the base
+      @return The smallest distance, k+1 if none is within k
+    */
+    unsigned final_distance(const PState& state, const unsigned& remaining) const
+    {
+        unsigned best = k + 1;
+        for (auto p: state) {
+            if (p.first <= remaining) {
+                best = std::min(best, p.second + remaining - p.first);
+            }
+        }
+
+        return best;
+
+    } // final_distance
+
+
+   private: // variables
+      unsigned                          k;          ///< the max. allowed Lev-distance
+      unsigned                          window;     ///< the length of the characteristic vectors
+      std::vector<PState>               states;     ///< all parametric states, indexed by id
+      std::map<PState, unsigned>        ids;        ///< the ids of all parametric states
+      std::vector<Transition>           table;      ///< transitions by state, remaining length and vector
+      std::vector<unsigned char>        distances;  ///< end-of-input distances by state and remaining length
+      std::vector<unsigned char>        bounds;     ///< the fewest errors of every state
+
+  }; // UniversalTable
+
+
+/**
+  @brief ParametricAutomaton applies a UniversalTable to one lookup word
+         Behaves like the DFAutomaton built from the Levenshtein NFA,
+         but nothing depending on the word has to be constructed
+*/
+class ParametricAutomaton
+  {
+   public: // Types
+      /// A state of the automaton: a parametric state and the word position it is relative to
+      struct State
+      {
+          unsigned          id;
+          unsigned          base;
+      };
+
+   private: // Types
+      typedef std::string                       Word;
+      typedef std::vector<Word>                 WordVec;
+
+
+   public: // Functions
+    /**
+      @brief Default constructor
+    */
+    ParametricAutomaton() : table(0)
+    {
+    }
+
+    /**
+      @brief Constructor from word and maximum edit distance
+      @param input, the lookup word
+      @param distance, the maximum edit distance (at most MAX_PARAMETRIC_DISTANCE)
+    */
+    ParametricAutomaton(const Word& input, const unsigned& distance)
+    {
+        lookupword = input;
+        table = &UniversalTable::get(distance);
+    }
+
+    /**
+      @brief Returns the start state of the automaton
+    */
+    State start() const
+    {
+        State s = {1, 0};
+        return s;
+
+    } // start
+
+    /**
+      @brief Looks for the next reachable state from a given state and an input character
+      @param src, a State
+      @param c, the input character
+      @return The reached state, its id is 0 if there is none
+    */
+    State next_state(const State& src, const unsigned char& c) const
+    {
+        unsigned remaining = std::min<std::size_t>(lookupword.size() - src.base, table->width());
+
+        // Characteristic vector of c within the next characters of the word
+        unsigned bits = 0;
+        for (unsigned p = 0; p < remaining; p++) {
+            if (static_cast<unsigned char>(lookupword[src.base + p]) == c) {
+                bits |= 1u << p;
+            }
+        }
+
+        const UniversalTable::Transition& t = table->next(src.id, remaining, bits);
+        State dest = {t.next, src.base + t.shift};
+        return dest;
+
+    } // next_state
+
+    /**
+      @brief Tests whether a given state is final
+      @param state, the state to be tested
+      @return true iff the input leading to this state is within distance k
+    */
+    bool is_final(const State& state) const
+    {
+        return state.id != 0 && distance(state) <= max_distance();
+
+    } // is_final
+
+    /**
+      @brief Tests whether a state is the dead state
+      @param state, the state to be tested
+      @return true iff no word can be accepted from here
+    */
+    bool is_dead(const State& state) const
+    {
+        return state.id == 0;
+
+    } // is_dead
+
+    /**
+      @brief Returns the edit distance between the lookup word and the input leading to a state
+      @param state, a State
+      @return The distance, or k+1 if it is larger than k
+    */
+    unsigned distance(const State& state) const
+    {
+        unsigned remaining = std::min<std::size_t>(lookupword.size() - state.base, table->width());
+        return table->distance(state.id, remaining);
+
+    } // distance
+
+    /**
+      @brief Returns a lower bound of the distance of every final state reachable from a state
+      @param state, a State
+    */
+    unsigned min_distance(const State& state) const
+    {
+        return table->bound(state.id);
+
+    } // min_distance
+
+    /**
+      @brief Searches the automaton for the next valid Word given an input Word
+             Uses the given buffers only, so it does not allocate once they are large enough;
+             they keep the path of the previous call, which is only walked back to where the input leaves it
+      @param input, a Word
+      @param result, the previous result or empty, receives the next valid Word from this one
+      @param stack, the states along the previous result or empty, receives the states along the new one
+      @return true iff there is a next valid Word
+    */
+    bool next_valid(const Word& input, Word& result, std::vector<State>& stack) const
+    {
+        return ::next_valid(*this, input, result, stack);
+
+    } // next_valid
+
+    /**
+      @brief Searches the automaton for the next valid Word given an input Word
+      @param input, a Word
+      @return The next valid Word from this one, or NONE
+    */
+    Word next_valid(const Word& input) const
+    {
+        Word result;
+        std::vector<State> stack;
+        if (next_valid(input, result, stack) == true) {
+            return result;
+        }
+
+        return NONE;
+
+    } // next_valid
+
+    /**
+      @brief Retrieves the smallest valid edge of a state starting at a given symbol
+      @param state, a State
+      @param first, the smallest symbol to be considered
+      @return The symbol of the next valid edge, or -1 if there is none
+    */
+    int find_next_edge(const State& state, const int& first) const
+    {
+        if (first > 255) { return -1; }
+
+        // Every character outside of the current window behaves the same; if such a character
+        // leads somewhere, so does every other one and the very next character is valid
+        unsigned remaining = std::min<std::size_t>(lookupword.size() - state.base, table->width());
+        if (table->next(state.id, remaining, 0).next != 0) {
+            return first;
+        }
+
+        // Otherwise only characters of the window are valid
+        int best = 256;
+        for (unsigned p = 0; p < remaining; p++) {
+            int c = static_cast<unsigned char>(lookupword[state.base + p]);
+            if (c >= first && c < best && next_state(state, c).id != 0) {
+                best = c;
+            }
+        }
+
+        if (best < 256) {
+            return best;
+        }
+
+        return -1;
+
+    } // find_next_edge
+
+    /**
+      @brief Returns the maximum edit distance of this automaton
+    */
+    unsigned max_distance() const
+    {
+        return (table->width() - 2) / 2;
+
+    } // max_distance
+
+
+   private: // variables
+      const UniversalTable*     table;      ///< the shared transitions for this k
+      Word                      lookupword; ///< the word the table is applied to
+
+  }; // ParametricAutomaton
+
+#endif // PARAMAUTOMATON_HPP_INCLUDED
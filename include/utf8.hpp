@@ -0,0 +1,332 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Decoding and encoding of UTF-8 for the codepoint automata
+*/
+
+#ifndef UTF8_HPP_INCLUDED
+#define UTF8_HPP_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "compileddfa.hpp"
+
+/**
+  @brief Utf8 knows the well-formed UTF-8 sequences as defined by Unicode
+         Every codepoint up to U+10FFFF except the surrogates has exactly one sequence of 1 to 4 bytes,
+         and sorting the sequences bytewise sorts them by codepoint
+*/
+class Utf8
+  {
+   public: // Types
+      enum { REPLACEMENT = 0xFFFD };    ///< stands for every byte that does not belong to a well-formed sequence
+
+
+   public: // Functions
+    /**
+      @brief Returns the length of the sequence a byte starts
+      @param lead, the first byte of a sequence
+      @return 1 to 4, or 0 if no well-formed sequence starts with this byte
+    */
+    static unsigned length(const unsigned char& lead)
+    {
+        if (lead < 0x80) { return 1; }
+        if (lead < 0xC2) { return 0; }
+        if (lead < 0xE0) { return 2; }
+        if (lead < 0xF0) { return 3; }
+        if (lead < 0xF5) { return 4; }
+        return 0;
+
+    } // length
+
+    /**
+      @brief Returns the range of the byte that may follow a lead byte,
+             which is narrower than 0x80 to 0xBF where it excludes overlong forms, surrogates or values above U+10FFFF
+      @param lead, the first byte of a sequence of at least 2 bytes
+      @param low, receives the smallest second byte
+      @param high, receives the largest second byte
+    */
+    static void second(const unsigned char& lead, unsigned char& low, unsigned char& high)
+    {
+        low = 0x80;
+        high = 0xBF;
+        if (lead == 0xE0) { low = 0xA0; }
+        if (lead == 0xED) { high = 0x9F; }
+        if (lead == 0xF0) { low = 0x90; }
+        if (lead == 0xF4) { high = 0x8F; }
+
+    } // second
+
+    /**
+      @brief Splits a string into its codepoints
+      @param word, UTF-8 encoded text
+      @return The codepoints, with REPLACEMENT for every byte that is not part of a well-formed sequence
+    */
+    static std::vector<std::uint32_t> decode(const std::string& word)
+    {
+        std::vector<std::uint32_t> codepoints;
+        std::size_t i = 0;
+        while (i < word.size()) {
+            const unsigned char lead = word[i];
+            unsigned n = length(lead);
+            if (n == 1) {
+                codepoints.push_back(lead);
+                i++;
+                continue;
+            }
+
+            // Check every continuation byte, the second one against its narrower range
+            unsigned char low = 0x80, high = 0xBF;
+            if (n > 1) { second(lead, low, high); }
+            std::uint32_t c = lead & (0x7F >> n);
+            unsigned j = 1;
+            for (; j < n && i + j < word.size(); j++) {
+                const unsigned char next = word[i + j];
+                if (next < low || next > high) { break; }
+
+                c = (c << 6) | (next & 0x3F);
+                low = 0x80;
+                high = 0xBF;
+            }
+
+            if (n == 0 || j < n) {
+                codepoints.push_back(REPLACEMENT);
+                i++;
+            }
+            else {
+                codepoints.push_back(c);
+                i += n;
+            }
+        }
+
+        return codepoints;
+
+    } // decode
+
+    /**
+      @brief Returns the UTF-8 sequence of a codepoint
+      @param c, a codepoint up to U+10FFFF that is not a surrogate
+    */
+    static std::string encode(const std::uint32_t& c)
+    {
+        std::string bytes;
+        if (c < 0x80) {
+            bytes += static_cast<char>(c);
+        }
+        else if (c < 0x800) {
+            bytes += static_cast<char>(0xC0 | (c >> 6));
+            bytes += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000) {
+            bytes += static_cast<char>(0xE0 | (c >> 12));
+            bytes += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (c & 0x3F));
+        }
+        else {
+            bytes += static_cast<char>(0xF0 | (c >> 18));
+            bytes += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            bytes += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (c & 0x3F));
+        }
+
+        return bytes;
+
+    } // encode
+
+  }; // Utf8
+
+/**
+  @brief Utf8Compiler turns a deterministic automaton over codepoints into a CompiledDFA over their UTF-8 bytes
+         It is filled like a CompiledDFA, but with codepoints as symbols; every state keeps its id,
+         the states added behind them read the rest of a sequence
+         The result accepts well-formed UTF-8 only, its lexicographic search never leaves it,
+         and it is run on the raw bytes of a bytewise sorted corpus
+*/
+class Utf8Compiler
+  {
+   public: // Types
+      typedef CompiledDFA::StateId              StateId;
+
+   private: // Types
+      /// A state of the automaton over bytes
+      struct Node
+      {
+          bool                                          final;
+          unsigned                                      distance;
+          unsigned                                      bound;
+          std::vector<std::pair<unsigned char, StateId>>  edges;      ///< sorted by byte
+          StateId                                       fallback;   ///< the default transition or NOSTATE
+          unsigned char                                 low;        ///< the bytes the default transition is taken for
+          unsigned char                                 high;
+      };
+
+      /// The edges of a state of the automaton over codepoints, as UTF-8 sequences
+      typedef std::vector<std::pair<std::string, StateId>>  SequenceVec;
+
+
+   public: // Functions
+    /**
+      @brief Adds a new state; the first one added is the start state
+      @param final, whether the new state is final
+      @param distance, the edit distance a final state stands for
+      @param bound, a lower bound of the distance of every final state reachable from the new state
+    */
+    void add_state(const bool& final, const unsigned& distance = 0, const unsigned& bound = 0)
+    {
+        Node node = {final, distance, bound, {}, CompiledDFA::NOSTATE, 0, 0};
+        nodes.push_back(node);
+        sequences.push_back(SequenceVec());
+
+    } // add_state
+
+    /**
+      @brief Adds a transition for a codepoint, in ascending order of the codepoints of every state
+      @param src, a state
+      @param codepoint, the input codepoint
+      @param dest, the reached state
+    */
+    void add_transition(const StateId& src, const std::uint32_t& codepoint, const StateId& dest)
+    {
+        sequences[src].push_back(std::make_pair(Utf8::encode(codepoint), dest));
+
+    } // add_transition
+
+    /**
+      @brief Establishes a default transition for all codepoints without an edge
+      @param src, a state
+      @param dest, the reached state
+    */
+    void set_default_transition(const StateId& src, const StateId& dest)
+    {
+        nodes[src].fallback = dest;
+
+    } // set_default_transition
+
+    /**
+      @brief Builds the automaton over bytes
+             A default transition becomes one for the ASCII bytes and an edge for every other lead byte
+             into a chain of states that read the continuation bytes of any codepoint
+    */
+    CompiledDFA compile()
+    {
+        const std::size_t count = sequences.size();
+        rests.clear();
+        for (StateId s = 0; s < count; s++) {
+            const SequenceVec& edges = sequences[s];
+            const StateId fallback = nodes[s].fallback;
+            std::vector<std::pair<unsigned char, StateId>> leads;
+
+            std::size_t e = 0;
+            for (unsigned lead = 0; lead < 256; lead++) {
+                std::size_t begin = e;
+                while (e < edges.size() && static_cast<unsigned char>(edges[e].first[0]) == lead) { e++; }
+
+                if (begin < e) {
+                    StateId dest = Utf8::length(lead) == 1 ? edges[begin].second : sequence(edges, begin, e, 1, fallback);
+                    leads.push_back(std::make_pair(static_cast<unsigned char>(lead), dest));
+                }
+                else if (fallback != CompiledDFA::NOSTATE && Utf8::length(lead) > 1) {
+                    unsigned char low, high;
+                    Utf8::second(lead, low, high);
+                    leads.push_back(std::make_pair(static_cast<unsigned char>(lead), rest(fallback, Utf8::length(lead) - 1, low, high)));
+                }
+            }
+
+            nodes[s].edges.swap(leads);
+            nodes[s].low = 0x00;
+            nodes[s].high = 0x7F;
+        }
+
+        CompiledDFA dfa;
+        for (StateId s = 0; s < nodes.size(); s++) {
+            const Node& node = nodes[s];
+            dfa.add_state(node.final, node.distance, node.bound);
+            for (auto& edge: node.edges) { dfa.add_transition(edge.first, edge.second); }
+            if (node.fallback != CompiledDFA::NOSTATE) {
+                dfa.set_default_transition(s, node.fallback, node.low, node.high);
+            }
+        }
+
+        return dfa;
+
+    } // compile
+
+
+   private: // Functions
+    /**
+      @brief Adds the state inside the sequences of some edges that share their first bytes
+      @param edges, the edges of a state over codepoints
+      @param begin, the first edge with these bytes
+      @param end, behind the last one
+      @param depth, how many bytes are shared and already read
+      @param fallback, the default transition of the state over codepoints
+      @return The new state, which reads the byte at depth
+    */
+    StateId sequence(const SequenceVec& edges, const std::size_t& begin, const std::size_t& end,
+                     const std::size_t& depth, const StateId& fallback)
+    {
+        const std::string& first = edges[begin].first;
+        const std::size_t length = first.size();
+
+        Node node = {false, 0, ~0u, {}, CompiledDFA::NOSTATE, 0x80, 0xBF};
+        if (depth == 1) { Utf8::second(first[0], node.low, node.high); }
+        if (fallback != CompiledDFA::NOSTATE) {
+            node.fallback = depth + 1 == length ? fallback : rest(fallback, length - depth - 1, 0x80, 0xBF);
+            node.bound = nodes[fallback].bound;
+        }
+
+        for (std::size_t e = begin; e < end; ) {
+            const unsigned char byte = edges[e].first[depth];
+            std::size_t next = e;
+            while (next < end && static_cast<unsigned char>(edges[next].first[depth]) == byte) { next++; }
+
+            StateId dest = depth + 1 == length ? edges[e].second : sequence(edges, e, next, depth + 1, fallback);
+            node.edges.push_back(std::make_pair(byte, dest));
+            node.bound = std::min(node.bound, nodes[dest].bound);
+            e = next;
+        }
+
+        nodes.push_back(node);
+        return nodes.size() - 1;
+
+    } // sequence
+
+    /**
+      @brief Returns the state that reads the continuation bytes of any codepoint and then goes to a given state
+      @param fallback, the state reached at the end of the sequence
+      @param bytes, how many continuation bytes are left
+      @param low, the smallest next byte
+      @param high, the largest next byte
+    */
+    StateId rest(const StateId& fallback, const unsigned& bytes, const unsigned char& low, const unsigned char& high)
+    {
+        std::tuple<StateId, unsigned, unsigned char, unsigned char> key(fallback, bytes, low, high);
+        auto pos = rests.find(key);
+        if (pos != rests.end()) { return pos->second; }
+
+        StateId next = bytes == 1 ? fallback : rest(fallback, bytes - 1, 0x80, 0xBF);
+        Node node = {false, 0, nodes[fallback].bound, {}, next, low, high};
+        nodes.push_back(node);
+        rests[key] = nodes.size() - 1;
+
+        return nodes.size() - 1;
+
+    } // rest
+
+
+   private: // variables
+      std::vector<Node>         nodes;      ///< the states over bytes, the states over codepoints first
+      std::vector<SequenceVec>  sequences;  ///< the edges of the states over codepoints
+      std::map<std::tuple<StateId, unsigned, unsigned char, unsigned char>, StateId>  rests;  ///< the states of rest()
+
+  }; // Utf8Compiler
+
+#endif // UTF8_HPP_INCLUDED
@@ -0,0 +1,256 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+
+Fixed set of worker threads that share loops by work stealing
+*/
+
+#ifndef WORKSTEALINGPOOL_HPP_INCLUDED
+#define WORKSTEALINGPOOL_HPP_INCLUDED
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+  @brief WorkStealingPool runs the iterations of a loop on a fixed set of threads
+         Every thread starts with an equal share of the iterations and works through it from the front;
+         a thread that runs out steals the back half of the largest share it finds,
+         so uneven iterations (e.g. short and long lookup words) still keep all threads busy
+         The thread calling parallel_for works as well, and the threads are kept between calls
+         Several threads may share a pool; their calls of parallel_for run one after the other
+*/
+class WorkStealingPool
+  {
+   private: // Types
+      /// The iterations [begin .. end) a thread has not started yet
+      struct Share
+      {
+          std::mutex        lock;
+          std::size_t       begin;
+          std::size_t       end;
+          char              padding[64];    ///< keeps the shares of different threads on different cache lines
+      };
+
+
+   public: // Functions
+    /**
+      @brief Constructor, starts the threads
+      @param threads, the number of threads including the calling one, 0 for one per core
+    */
+    explicit WorkStealingPool(unsigned threads = 0)
+    {
+        if (threads == 0) { threads = std::thread::hardware_concurrency(); }
+        if (threads == 0) { threads = 1; }
+
+        generation = 0;
+        running = 0;
+        stop = false;
+        task = nullptr;
+
+        for (unsigned t = 0; t < threads; t++) {
+            shares.push_back(std::unique_ptr<Share>(new Share()));
+            shares.back()->begin = 0;
+            shares.back()->end = 0;
+        }
+        for (unsigned t = 1; t < threads; t++) {
+            workers.push_back(std::thread(&WorkStealingPool::wait_for_work, this, t));
+        }
+    }
+
+    /// The pool owns its threads
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+      @brief Destructor, stops and joins the threads
+    */
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(control);
+            stop = true;
+        }
+        wake.notify_all();
+
+        for (auto& w: workers) {
+            w.join();
+        }
+    }
+
+    /**
+      @brief Number of threads, including the calling one
+    */
+    unsigned size() const
+    {
+        return shares.size();
+
+    } // size
+
+    /**
+      @brief Calls a function for every index 0 .. count-1 and returns once all calls are done
+             The calls run concurrently in no particular order; the function must not throw
+             and must not call parallel_for of the same pool
+             A parallel_for of another thread on the same pool is waited for before this one starts
+      @param count, the number of iterations
+      @param function, is called with every index exactly once
+    */
+    void parallel_for(const std::size_t& count, const std::function<void(std::size_t)>& function)
+    {
+        if (count == 0) { return; }
+        if (count == 1 || size() == 1) {
+            for (std::size_t i = 0; i < count; i++) { function(i); }
+            return;
+        }
+
+        // The shares and the task belong to one call at a time
+        std::lock_guard<std::mutex> call(calling);
+
+        // Deal out equal shares before anyone starts
+        for (std::size_t t = 0; t < size(); t++) {
+            std::lock_guard<std::mutex> guard(shares[t]->lock);
+            shares[t]->begin = count * t / size();
+            shares[t]->end = count * (t + 1) / size();
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(control);
+            task = &function;
+            running = size() - 1;
+            generation++;
+        }
+        wake.notify_all();
+
+        work(0);
+
+        // Everything is taken once this thread is out of work, wait for the calls still running
+        std::unique_lock<std::mutex> guard(control);
+        done.wait(guard, [this]() { return running == 0; });
+        task = nullptr;
+
+    } // parallel_for
+
+
+   private: // Functions
+    /**
+      @brief Main loop of the worker threads
+      @param self, the number of this thread
+    */
+    void wait_for_work(const unsigned self)
+    {
+        unsigned long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(control);
+                wake.wait(guard, [this, seen]() { return stop == true || generation != seen; });
+                if (stop == true) { return; }
+                seen = generation;
+            }
+
+            work(self);
+
+            {
+                std::lock_guard<std::mutex> guard(control);
+                running--;
+            }
+            done.notify_one();
+        } // while
+
+    } // wait_for_work
+
+    /**
+      @brief Runs iterations of the current task until none are left to take or steal
+      @param self, the number of this thread
+    */
+    void work(const unsigned self)
+    {
+        std::size_t i = 0;
+        while (take(self, i) == true || (steal(self) == true && take(self, i) == true)) {
+            (*task)(i);
+        }
+
+    } // work
+
+    /**
+      @brief Takes the first iteration of a thread's own share
+      @param self, the number of this thread
+      @param i, receives the iteration
+      @return false iff the share is empty
+    */
+    bool take(const unsigned self, std::size_t& i)
+    {
+        Share& own = *shares[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.begin == own.end) { return false; }
+
+        i = own.begin++;
+        return true;
+
+    } // take
+
+    /**
+      @brief Moves the back half of the largest other share into the empty share of a thread
+      @param self, the number of this thread
+      @return false iff all other shares are empty
+    */
+    bool steal(const unsigned self)
+    {
+        while (true) {
+            // Look for the largest share, which may have shrunk by the time it is locked again
+            unsigned victim = self;
+            std::size_t largest = 0;
+            for (unsigned t = 0; t < size(); t++) {
+                if (t == self) { continue; }
+
+                std::lock_guard<std::mutex> guard(shares[t]->lock);
+                std::size_t remaining = shares[t]->end - shares[t]->begin;
+                if (remaining > largest) {
+                    largest = remaining;
+                    victim = t;
+                }
+            }
+            if (victim == self) { return false; }
+
+            std::size_t begin = 0;
+            std::size_t end = 0;
+            {
+                std::lock_guard<std::mutex> guard(shares[victim]->lock);
+                Share& other = *shares[victim];
+                if (other.begin == other.end) { continue; }
+
+                // The back half, rounded up, so a single iteration is stolen as well
+                begin = other.begin + (other.end - other.begin) / 2;
+                end = other.end;
+                other.end = begin;
+            }
+
+            std::lock_guard<std::mutex> guard(shares[self]->lock);
+            shares[self]->begin = begin;
+            shares[self]->end = end;
+            return true;
+        } // while
+
+    } // steal
+
+
+   private: // variables
+      std::vector<std::unique_ptr<Share>>           shares;     ///< the untaken iterations of every thread
+      std::vector<std::thread>                      workers;    ///< all threads but the calling one
+      const std::function<void(std::size_t)>*       task;       ///< the loop body of the current parallel_for
+      std::mutex                                    calling;    ///< held by the thread inside parallel_for
+      std::mutex                                    control;    ///< guards the variables below
+      std::condition_variable                       wake;       ///< signals a new task or stop to the workers
+      std::condition_variable                       done;       ///< signals a finished worker
+      unsigned long long                            generation; ///< counts the tasks handed out
+      unsigned                                      running;    ///< the workers still busy with the current task
+      bool                                          stop;       ///< whether the threads shall end
+
+  }; // WorkStealingPool
+
+#endif // WORKSTEALINGPOOL_HPP_INCLUDED
@@ -0,0 +1,53 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+*/
+
+/**
+  @brief Builds a binary dictionary file from a corpus file
+         The result can be loaded with Corpus::load, which maps it instead of reading and sorting the words
+*/
+
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <string>
+
+#include "corpus.hpp"
+
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <corpus file> <dictionary file>\n";
+        return -1;
+    }
+
+    std::ifstream filey(argv[1]);
+    if (!filey) {
+        std::cerr << "Could not open '" << argv[1] << "'\n";
+        return -2;
+    }
+
+    // Read the given corpus file into a vector, with every word in lowercase like the demos do
+    std::vector<std::string> corpus;
+    std::string line;
+    while(filey >> line) {
+        std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+        corpus.push_back(line);
+    }
+
+    Corpus dictionary(corpus);
+    if (dictionary.save(argv[2]) == false) {
+        std::cerr << "Could not write '" << argv[2] << "'\n";
+        return -3;
+    }
+
+    std::cout << "Wrote " << dictionary.size() << " words in "
+              << dictionary.get_index().node_count() << " nodes to '" << argv[2] << "'\n";
+
+    return 0;
+}
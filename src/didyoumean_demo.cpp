@@ -33,49 +33,68 @@ int main(int argc, char** argv)
         return -1;
     }
 
-    std::ifstream filey(argv[1]);
-    if (!filey) {
-        std::cerr << "Could not open '" << argv[1] << "'\n";
-        return -2;
-    }
+    CorpusPtr dictionary;
 
-    // Read the given corpus file into a vector
-    std::vector<std::string> corpus;
-    std::string line;
-    while(filey >> line) {
-        std::size_t pos = line.find(" ");
-        if (pos != std::string::npos) {
-            std::cerr << " Line " << line << " seems to contain more than one word and is ignored.\n";
-        }
-        else {
-            // Tranform each valid word to lowercase
-            std::transform(line.begin(), line.end(), line.begin(), ::tolower);
-            corpus.push_back(line);
+    // A dictionary file written by dictbuild is mapped as it is
+    if (Corpus::is_index_file(argv[1]) == true) {
+        dictionary = Corpus::load(argv[1]);
+        if (dictionary == nullptr) {
+            std::cerr << "Could not load '" << argv[1] << "'\n";
+            return -2;
         }
     }
+    else {
+        std::ifstream filey(argv[1]);
+        if (!filey) {
+            std::cerr << "Could not open '" << argv[1] << "'\n";
+            return -2;
+        }
+
+        // Read the given corpus file into a vector
+        std::vector<std::string> corpus;
+        std::string line;
+        while(filey >> line) {
+            std::size_t pos = line.find(" ");
+            if (pos != std::string::npos) {
+                std::cerr << " Line " << line << " seems to contain more than one word and is ignored.\n";
+            }
+            else {
+                // Tranform each valid word to lowercase
+                std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+                corpus.push_back(line);
+            }
+        }
 
-    // Sort the corpus alphabetically
-    std::sort(corpus.begin(), corpus.end());
+        // Sort the corpus alphabetically
+        std::sort(corpus.begin(), corpus.end());
+
+        // Index it once, all lookups share it
+        dictionary = std::make_shared<Corpus>(corpus);
+    }
 
     std::string input;
     std::cout << "\nPlease type a (misspelled) word: ";
     std::cin >> input;
 
-    if (std::find(corpus.begin(), corpus.end(), input) != corpus.end()) { std::cout << "(y) This is a valid word.\n"; return 0; }
+    if (dictionary->contains(input)) { std::cout << "(y) This is a valid word.\n"; return 0; }
 
     else {
-        for (int i = 1; i <= 5; i++) {
-            LevenshteinAutomaton lev(input, i, corpus);
-            std::vector<std::string> matches = lev.get_all_matches();
+        // One search finds the closest words up to the largest distance of the universal tables,
+        // only if there are none the automaton for a larger distance is built by subset construction
+        const unsigned limits[] = {MAX_PARAMETRIC_DISTANCE, 5};
+        for (auto limit: limits) {
+            LevenshteinAutomaton lev(input, limit, dictionary, LevenshteinAutomaton::PARAMETRIC);
+            unsigned distance = 0;
+            std::vector<std::string> matches = lev.get_closest_matches(distance);
             if (matches.size() > 0) {
-                std::cout << "Did you mean to write any of these words?\n";
+                std::cout << "Did you mean to write any of these words? (Levensthein distance " << distance << ")\n";
                 for (auto m: matches) {
                     std::cout << m << "\t";
                 }
                 std::cout << "\n";
                 return 0;
             }
-            else { std::cout << "Could not find any words in Levensthein distance " << i << ".\n"; }
+            else { std::cout << "Could not find any words in Levensthein distance " << limit << ".\n"; }
         }
     }
 }
@@ -0,0 +1,483 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+*/
+
+/**
+  @brief Benchmarks building and searching Levenshtein automata on generated or given corpora
+         Sweeps modes, k and query lengths and reports the time of every phase per query,
+         queries per second, heap allocations and the peak resident memory as CSV or JSON
+         Everything is generated from a seed, so two runs with the same options can be compared
+*/
+
+#include <iostream>
+#include <set>
+#include <map>
+#include <vector>
+#include <tuple>
+#include <fstream>
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#else
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include "levautomaton.hpp"
+
+
+// Every allocation of the program passes through here and is counted;
+// all forms of new and delete are replaced together, so that each block is freed the way it was allocated
+static unsigned long long allocations = 0;
+static unsigned long long allocated_bytes = 0;
+
+static void* counted_malloc(std::size_t size) noexcept
+{
+    allocations++;
+    allocated_bytes += size;
+    return std::malloc(size > 0 ? size : 1);
+}
+
+// Kept out of line, else GCC sees free() on a block from operator new where a replaced delete is inlined
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void counted_free(void* p) noexcept
+{
+    std::free(p);
+}
+
+void* operator new(std::size_t size)
+{
+    void* p = counted_malloc(size);
+    if (p == nullptr) { throw std::bad_alloc(); }
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* p = counted_malloc(size);
+    if (p == nullptr) { throw std::bad_alloc(); }
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_malloc(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_malloc(size); }
+
+void operator delete(void* p) noexcept { counted_free(p); }
+void operator delete[](void* p) noexcept { counted_free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { counted_free(p); }
+void operator delete(void* p, std::size_t) noexcept { counted_free(p); }
+void operator delete[](void* p, std::size_t) noexcept { counted_free(p); }
+
+
+/// The options of a run
+struct Options
+{
+    std::size_t                 words;      ///< the size of a generated corpus
+    std::string                 alphabet;   ///< dna, latin, bytes or syllables
+    std::string                 corpus;     ///< a corpus file used instead of a generated one
+    std::size_t                 queries;    ///< the queries per combination of mode, k and length
+    std::vector<unsigned>       ks;
+    std::vector<unsigned>       lengths;
+    std::vector<std::string>    modes;
+    unsigned                    seed;
+    std::string                 format;     ///< csv or json
+    std::string                 out;        ///< the output file, standard output if empty
+    std::string                 stats;      ///< where LevStats is written to, if compiled with LEV_ENABLE_STATS
+};
+
+/// The measurements of one combination of mode, k and query length
+struct Result
+{
+    std::string         mode;
+    unsigned            k;
+    unsigned            length;
+    double              build_us;           ///< constructing the automaton, i.e. the NFA for subset construction
+    double              determinize_us;     ///< the subset construction, 0 for the other modes
+    double              traverse_us;        ///< the search through the corpus
+    double              qps;
+    double              matches;            ///< per query
+    double              allocations;        ///< per query
+    double              allocated_bytes;    ///< per query
+    double              dfa_states;         ///< per query, subset construction only
+    long                peak_rss_kb;        ///< of the process after the combination
+};
+
+
+/**
+  @brief Returns the peak resident memory of the process in KiB
+*/
+long peak_rss_kb()
+{
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize / 1024;
+#endif
+
+} // peak_rss_kb
+
+/**
+  @brief Microseconds since a point in time
+*/
+double since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+} // since
+
+/**
+  @brief Splits a comma separated list
+*/
+std::vector<std::string> split(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (item.empty() == false) { items.push_back(item); }
+    }
+    return items;
+
+} // split
+
+/**
+  @brief Returns the letters of an alphabet, syllables are made of latin letters
+*/
+std::string letters(const std::string& alphabet)
+{
+    if (alphabet == "dna") { return "acgt"; }
+    if (alphabet == "bytes") {
+        std::string printable;
+        for (char c = 33; c < 127; c++) { printable.push_back(c); }
+        return printable;
+    }
+    return "abcdefghijklmnopqrstuvwxyz";
+
+} // letters
+
+/**
+  @brief Generates a random word
+         The syllables alphabet concatenates syllables of onset, vowel and coda whose frequencies
+         follow Zipf's law, so words share prefixes and lengths like those of a natural language dictionary;
+         the others draw letters uniformly with a length around 8
+*/
+std::string random_word(const std::string& alphabet, std::mt19937& rng)
+{
+    static const std::vector<std::string> syllables = []() {
+        const char* const onsets[] = {"", "b", "ch", "d", "f", "g", "h", "k", "l", "m", "n", "p", "r", "s", "sch", "st", "t", "v", "w", "z"};
+        const char* const vowels[] = {"e", "a", "i", "o", "u", "ei", "au"};
+        const char* const codas[] = {"", "n", "r", "s", "t", "ng", "ch", "l"};
+        std::vector<std::string> all;
+        for (auto onset: onsets) {
+            for (auto vowel: vowels) {
+                for (auto coda: codas) { all.push_back(std::string(onset) + vowel + coda); }
+            }
+        }
+
+        // A fixed shuffle decides which syllables are frequent
+        std::shuffle(all.begin(), all.end(), std::mt19937(42));
+        return all;
+    }();
+
+    std::string word;
+    if (alphabet == "syllables") {
+        // Zipf: syllable r is drawn with a weight of 1/(r+1)
+        static std::discrete_distribution<std::size_t> zipf = []() {
+            std::vector<double> weights;
+            for (std::size_t r = 0; r < syllables.size(); r++) { weights.push_back(1.0 / (r + 1)); }
+            return std::discrete_distribution<std::size_t>(weights.begin(), weights.end());
+        }();
+
+        std::size_t parts = 1 + rng() % 4;
+        for (std::size_t i = 0; i < parts; i++) { word += syllables[zipf(rng)]; }
+        return word;
+    }
+
+    const std::string chars = letters(alphabet);
+    std::binomial_distribution<std::size_t> length(14, 0.5);
+    std::size_t size = 1 + length(rng);
+    for (std::size_t i = 0; i < size; i++) { word.push_back(chars[rng() % chars.size()]); }
+    return word;
+
+} // random_word
+
+/**
+  @brief Generates a query of a given length near a corpus word, with up to k random edits
+*/
+std::string random_query(const std::vector<std::string>& words, const std::string& alphabet,
+                         const unsigned& length, const unsigned& k, std::mt19937& rng)
+{
+    const std::string chars = letters(alphabet == "syllables" ? "latin" : alphabet);
+
+    std::string query = words[rng() % words.size()];
+    while (query.size() < length) { query.push_back(chars[rng() % chars.size()]); }
+    query.resize(length);
+
+    unsigned edits = k > 0 ? rng() % (k + 1) : 0;
+    for (unsigned e = 0; e < edits && query.empty() == false; e++) {
+        std::size_t pos = rng() % query.size();
+        query[pos] = chars[rng() % chars.size()];
+    }
+    return query;
+
+} // random_query
+
+/**
+  @brief Parses a mode name
+*/
+bool parse_mode(const std::string& name, LevenshteinAutomaton::Mode& mode)
+{
+    if (name == "subset") { mode = LevenshteinAutomaton::SUBSET_CONSTRUCTION; }
+    else if (name == "parametric") { mode = LevenshteinAutomaton::PARAMETRIC; }
+    else if (name == "bitparallel") { mode = LevenshteinAutomaton::BIT_PARALLEL; }
+    else if (name == "columnar") { mode = LevenshteinAutomaton::COLUMNAR_SCAN; }
+    else if (name == "lazy") { mode = LevenshteinAutomaton::LAZY_DFA; }
+    else { return false; }
+
+    return true;
+
+} // parse_mode
+
+/**
+  @brief Runs the queries of one combination of mode, k and query length
+*/
+Result measure(const CorpusPtr& corpus, const std::string& name, const unsigned& k, const unsigned& length,
+               const Options& options)
+{
+    LevenshteinAutomaton::Mode mode = LevenshteinAutomaton::SUBSET_CONSTRUCTION;
+    parse_mode(name, mode);
+
+    // The same queries for every mode
+    std::mt19937 rng(options.seed + 7919 * k + length);
+    std::vector<std::string> queries;
+    for (std::size_t q = 0; q < options.queries; q++) {
+        queries.push_back(random_query(corpus->get_words(), options.alphabet, length, k, rng));
+    }
+
+    Result result = {name, k, length, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    const unsigned long long allocations_before = allocations;
+    const unsigned long long bytes_before = allocated_bytes;
+    double total = 0;
+
+    for (auto& query: queries) {
+        auto start = std::chrono::steady_clock::now();
+        LevenshteinAutomaton automaton(query, k, corpus, mode);
+        result.build_us += since(start);
+
+        if (mode == LevenshteinAutomaton::SUBSET_CONSTRUCTION) {
+            auto determinize = std::chrono::steady_clock::now();
+            result.dfa_states += automaton.get_compiled_dfa().size();
+            result.determinize_us += since(determinize);
+        }
+
+        auto traverse = std::chrono::steady_clock::now();
+        result.matches += automaton.get_all_matches().size();
+        result.traverse_us += since(traverse);
+
+        total += since(start);
+    }
+
+    const double n = std::max<std::size_t>(queries.size(), 1);
+    result.build_us /= n;
+    result.determinize_us /= n;
+    result.traverse_us /= n;
+    result.qps = total > 0 ? queries.size() * 1e6 / total : 0;
+    result.matches /= n;
+    result.allocations = (allocations - allocations_before) / n;
+    result.allocated_bytes = (allocated_bytes - bytes_before) / n;
+    result.dfa_states /= n;
+    result.peak_rss_kb = peak_rss_kb();
+
+    return result;
+
+} // measure
+
+/**
+  @brief Writes the results as CSV, one row per combination
+*/
+void write_csv(std::ostream& out, const Options& options, const std::size_t& words, const double& corpus_us,
+               const std::vector<Result>& results)
+{
+    out << "alphabet,words,seed,corpus_us,mode,k,length,queries,build_us,determinize_us,traverse_us,"
+        << "qps,matches,allocations,allocated_bytes,dfa_states,peak_rss_kb\n";
+    for (auto& r: results) {
+        out << options.alphabet << "," << words << "," << options.seed << "," << corpus_us << ","
+            << r.mode << "," << r.k << "," << r.length << "," << options.queries << ","
+            << r.build_us << "," << r.determinize_us << "," << r.traverse_us << ","
+            << r.qps << "," << r.matches << "," << r.allocations << "," << r.allocated_bytes << ","
+            << r.dfa_states << "," << r.peak_rss_kb << "\n";
+    }
+
+} // write_csv
+
+/**
+  @brief Writes the results as one JSON object with the options and a list of results
+*/
+void write_json(std::ostream& out, const Options& options, const std::size_t& words, const double& corpus_us,
+                const std::vector<Result>& results)
+{
+    out << "{\n  \"alphabet\": \"" << options.alphabet << "\", \"words\": " << words
+        << ", \"seed\": " << options.seed << ", \"queries\": " << options.queries
+        << ", \"corpus_us\": " << corpus_us << ",\n  \"results\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "    {\"mode\": \"" << r.mode << "\", \"k\": " << r.k << ", \"length\": " << r.length
+            << ", \"build_us\": " << r.build_us << ", \"determinize_us\": " << r.determinize_us
+            << ", \"traverse_us\": " << r.traverse_us << ", \"qps\": " << r.qps
+            << ", \"matches\": " << r.matches << ", \"allocations\": " << r.allocations
+            << ", \"allocated_bytes\": " << r.allocated_bytes << ", \"dfa_states\": " << r.dfa_states
+            << ", \"peak_rss_kb\": " << r.peak_rss_kb << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+
+} // write_json
+
+/**
+  @brief Prints the options
+*/
+void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --words N          size of the generated corpus, 10000 to 10000000 (100000)\n"
+              << "  --alphabet A       dna, latin, bytes or syllables (latin)\n"
+              << "  --corpus FILE      use the words of a file instead of generating them\n"
+              << "  --queries Q        queries per mode, k and length (200)\n"
+              << "  --k LIST           maximum edit distances (0,1,2,3)\n"
+              << "  --lengths LIST     query lengths (4,8,12)\n"
+              << "  --modes LIST       subset, parametric, bitparallel, columnar, lazy (all)\n"
+              << "  --seed S           seed of all random choices (1)\n"
+              << "  --format F         csv or json (csv)\n"
+              << "  --out FILE         write the results to a file\n"
+              << "  --stats FILE       write the counters and histograms of LEV_ENABLE_STATS to a file\n";
+
+} // usage
+
+
+int main(int argc, char** argv)
+{
+    Options options = {100000, "latin", "", 200, {0, 1, 2, 3}, {4, 8, 12},
+                       {"subset", "parametric", "bitparallel", "columnar", "lazy"}, 1, "csv", "", ""};
+
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (i + 1 >= argc) { usage(argv[0]); return -1; }
+        std::string value = argv[++i];
+
+        if (option == "--words") { options.words = std::strtoul(value.c_str(), nullptr, 10); }
+        else if (option == "--alphabet") { options.alphabet = value; }
+        else if (option == "--corpus") { options.corpus = value; }
+        else if (option == "--queries") { options.queries = std::strtoul(value.c_str(), nullptr, 10); }
+        else if (option == "--seed") { options.seed = std::strtoul(value.c_str(), nullptr, 10); }
+        else if (option == "--format") { options.format = value; }
+        else if (option == "--out") { options.out = value; }
+        else if (option == "--stats") { options.stats = value; }
+        else if (option == "--modes") { options.modes = split(value); }
+        else if (option == "--k" || option == "--lengths") {
+            std::vector<unsigned>& list = option == "--k" ? options.ks : options.lengths;
+            list.clear();
+            for (auto& item: split(value)) { list.push_back(std::strtoul(item.c_str(), nullptr, 10)); }
+        }
+        else { usage(argv[0]); return -1; }
+    }
+
+    LevenshteinAutomaton::Mode mode;
+    for (auto& name: options.modes) {
+        if (parse_mode(name, mode) == false) {
+            std::cerr << "Unknown mode '" << name << "'\n";
+            return -1;
+        }
+    }
+
+    // Generate or read the corpus
+    std::vector<std::string> words;
+    if (options.corpus.empty() == false) {
+        std::ifstream filey(options.corpus);
+        if (!filey) {
+            std::cerr << "Could not open '" << options.corpus << "'\n";
+            return -2;
+        }
+        std::string line;
+        while(filey >> line) { words.push_back(line); }
+        options.alphabet = "file";
+    }
+    else {
+        std::mt19937 rng(options.seed);
+        words.reserve(options.words);
+        for (std::size_t w = 0; w < options.words; w++) { words.push_back(random_word(options.alphabet, rng)); }
+    }
+
+    if (words.empty() == true) {
+        std::cerr << "The corpus is empty\n";
+        return -2;
+    }
+
+    // The columnar layout is only built if it is needed
+    bool columnar = std::find(options.modes.begin(), options.modes.end(), "columnar") != options.modes.end();
+    auto start = std::chrono::steady_clock::now();
+    CorpusPtr corpus = std::make_shared<Corpus>(words, true, columnar);
+    double corpus_us = since(start);
+    words.clear();
+    words.shrink_to_fit();
+
+    std::vector<Result> results;
+    for (auto& name: options.modes) {
+        for (auto k: options.ks) {
+            for (auto length: options.lengths) {
+                results.push_back(measure(corpus, name, k, length, options));
+            }
+        }
+    }
+
+    std::ofstream file;
+    if (options.out.empty() == false) {
+        file.open(options.out);
+        if (!file) {
+            std::cerr << "Could not write '" << options.out << "'\n";
+            return -3;
+        }
+    }
+    std::ostream& out = options.out.empty() == false ? file : std::cout;
+
+    if (options.format == "json") {
+        write_json(out, options, corpus->size(), corpus_us, results);
+    }
+    else {
+        write_csv(out, options, corpus->size(), corpus_us, results);
+    }
+
+    if (options.stats.empty() == false) {
+        if (LEV_ENABLE_STATS == 0) {
+            std::cerr << "Statistics are not compiled in, build with LEV_ENABLE_STATS=1\n";
+        }
+        std::ofstream statsfile(options.stats);
+        if (!statsfile) {
+            std::cerr << "Could not write '" << options.stats << "'\n";
+            return -3;
+        }
+        LevStats::global().write(statsfile);
+    }
+
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+*/
+
+/**
+  @brief Sends the words read from standard input to a lev_server in batches, several requests in flight at once,
+         prints the matches of every word and the latency of every request as the server measured it
+         and as a round trip, and the distribution of the round trips at the end
+         Needs POSIX sockets
+*/
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "levprotocol.hpp"
+
+
+/// What every request asks for and how they are sent
+struct Options
+{
+    LevProtocol::Request    request;    ///< the fields of every request besides its id and words
+    std::size_t             batch;      ///< the words per request
+    std::size_t             depth;      ///< the requests sent without waiting for an answer
+    bool                    quiet;      ///< whether only the latencies are printed
+};
+
+/**
+  @brief Writes all of a buffer to a socket
+  @return false if the connection is lost
+*/
+bool write_all(const int& fd, const std::string& out)
+{
+    std::size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = write(fd, out.data() + done, out.size() - done);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        done += n;
+    }
+
+    return true;
+
+} // write_all
+
+/**
+  @brief Reads from a socket until a complete response has arrived
+  @param fd, the socket
+  @param in, the bytes received so far, the response is removed from it
+  @param response, receives the response
+  @return false if the connection is lost or the response is malformed
+*/
+bool read_response(const int& fd, std::string& in, LevProtocol::Response& response)
+{
+    char chunk[1 << 16];
+    std::size_t size = LevProtocol::frame(in.data(), in.size());
+    while (size == 0) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        in.append(chunk, n);
+        size = LevProtocol::frame(in.data(), in.size());
+    }
+
+    bool valid = LevProtocol::decode(in.data(), size, response);
+    in.erase(0, size);
+    return valid;
+
+} // read_response
+
+/**
+  @brief Prints the options
+*/
+void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <socket> [options] < words\n"
+              << "  --op O             check, match or closest (match)\n"
+              << "  --k K              maximum edit distance (1)\n"
+              << "  --limit L          at most L matches per word, 0 for all (0)\n"
+              << "  --mode M           subset, parametric, bitparallel, columnar or lazy (parametric)\n"
+              << "  --costs C          levenshtein or damerau (levenshtein)\n"
+              << "  --symbols S        bytes or utf8 (bytes)\n"
+              << "  --batch B          words per request (16)\n"
+              << "  --depth D          requests in flight (8)\n"
+              << "  --quiet            print the latencies only\n";
+
+} // usage
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    Options options;
+    options.request.id = 0;
+    options.request.op = LevProtocol::MATCH;
+    options.request.k = 1;
+    options.request.flags = 0;
+    options.request.mode = 1;
+    options.request.limit = 0;
+    options.batch = 16;
+    options.depth = 8;
+    options.quiet = false;
+
+    const char* const ops[] = {"", "check", "match", "closest"};
+    const char* const modes[] = {"subset", "parametric", "bitparallel", "columnar", "lazy"};
+
+    for (int i = 2; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--quiet") {
+            options.quiet = true;
+            continue;
+        }
+        if (i + 1 >= argc) { usage(argv[0]); return -1; }
+        std::string value = argv[++i];
+
+        if (option == "--op") {
+            auto pos = std::find(ops + 1, ops + 4, value);
+            if (pos == ops + 4) { usage(argv[0]); return -1; }
+            options.request.op = pos - ops;
+        }
+        else if (option == "--mode") {
+            auto pos = std::find(modes, modes + 5, value);
+            if (pos == modes + 5) { usage(argv[0]); return -1; }
+            options.request.mode = pos - modes;
+        }
+        else if (option == "--costs" && (value == "levenshtein" || value == "damerau")) {
+            if (value == "damerau") { options.request.flags |= LevProtocol::DAMERAU; }
+        }
+        else if (option == "--symbols" && (value == "bytes" || value == "utf8")) {
+            if (value == "utf8") { options.request.flags |= LevProtocol::UTF8; }
+        }
+        else if (option == "--k") { options.request.k = std::strtoul(value.c_str(), nullptr, 10); }
+        else if (option == "--limit") { options.request.limit = std::strtoul(value.c_str(), nullptr, 10); }
+        else if (option == "--batch") { options.batch = std::max<std::size_t>(1, std::strtoul(value.c_str(), nullptr, 10)); }
+        else if (option == "--depth") { options.depth = std::max<std::size_t>(1, std::strtoul(value.c_str(), nullptr, 10)); }
+        else { usage(argv[0]); return -1; }
+    }
+
+    // Cut the words into requests
+    std::vector<LevProtocol::Request> requests;
+    std::string word;
+    while (std::cin >> word) {
+        if (word.size() > 0xFFFF) { continue; }
+        if (requests.empty() == true || requests.back().words.size() == options.batch) {
+            requests.push_back(options.request);
+            requests.back().id = requests.size();
+        }
+        requests.back().words.push_back(word);
+    }
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Could not connect to '" << argv[1] << "': " << std::strerror(errno) << "\n";
+        return -2;
+    }
+
+    // Keep up to depth requests in flight, the answers come back in order
+    typedef std::chrono::steady_clock Clock;
+    std::vector<Clock::time_point> sent(requests.size());
+    std::vector<double> round_trips;
+    std::string in;
+    std::string out;
+    std::size_t next = 0;
+
+    for (std::size_t done = 0; done < requests.size(); done++) {
+        out.clear();
+        for (; next < requests.size() && next < done + options.depth; next++) {
+            LevProtocol::encode(requests[next], out);
+            sent[next] = Clock::now();
+        }
+        if (out.empty() == false && write_all(fd, out) == false) {
+            std::cerr << "The server closed the connection\n";
+            return -3;
+        }
+
+        LevProtocol::Response response;
+        if (read_response(fd, in, response) == false) {
+            std::cerr << "The server closed the connection or sent a malformed response\n";
+            return -3;
+        }
+        double us = std::chrono::duration<double, std::micro>(Clock::now() - sent[done]).count();
+        round_trips.push_back(us);
+
+        const LevProtocol::Request& request = requests[done];
+        std::cerr << "request " << response.id << ": " << request.words.size() << " words, status " << response.status
+                  << ", server " << response.latency << " us, round trip " << us << " us\n";
+        if (options.quiet == true || response.status != LevProtocol::OK) { continue; }
+
+        for (std::size_t q = 0; q < response.results.size() && q < request.words.size(); q++) {
+            std::cout << request.words[q] << ":";
+            for (auto& m: response.results[q]) { std::cout << " " << m.word << "(" << m.distance << ")"; }
+            std::cout << "\n";
+        }
+    }
+    close(fd);
+
+    if (round_trips.empty() == false) {
+        std::sort(round_trips.begin(), round_trips.end());
+        std::cerr << requests.size() << " requests, round trip p50 " << round_trips[round_trips.size() / 2]
+                  << " us, p99 " << round_trips[round_trips.size() * 99 / 100]
+                  << " us, max " << round_trips.back() << " us\n";
+    }
+
+    return 0;
+}
@@ -53,9 +53,12 @@ int main(int argc, char** argv)
     // Sort the corpus alphabetically
     std::sort(corpus.begin(), corpus.end());
 
+    // Index it once, all lookups share it
+    CorpusPtr dictionary = std::make_shared<Corpus>(corpus);
+
     // Run a test with 'badger' and k = 1
     std::cout << "\nAll matches for word 'badger' in Levensthein distance 1:\n";
-    LevenshteinAutomaton lev_b("badger", 1, corpus);
+    LevenshteinAutomaton lev_b("badger", 1, dictionary);
     std::vector<std::string> matches = lev_b.get_all_matches();
     for (auto m: matches) {
         std::cout << m << "\t";
@@ -69,7 +72,7 @@ int main(int argc, char** argv)
 
     // Run a test with 'duckling' and k = 2
     std::cout << "\nAll matches for word 'duckling' in Levensthein distance 2:\n";
-    LevenshteinAutomaton lev_d("duckling", 2, corpus);
+    LevenshteinAutomaton lev_d("duckling", 2, dictionary);
     matches = lev_d.get_all_matches();
     for (auto m: matches) {
         std::cout << m << "\t";
@@ -83,7 +86,7 @@ int main(int argc, char** argv)
 
     // Run a test with 'crocodile' and k = 3
     std::cout << "\nAll matches for word 'crocodile' in Levensthein distance 3:\n";
-    LevenshteinAutomaton lev_c("crocodile", 3, corpus);
+    LevenshteinAutomaton lev_c("crocodile", 3, dictionary);
     matches = lev_c.get_all_matches();
     for (auto m: matches) {
         std::cout << m << "\t";
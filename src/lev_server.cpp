@@ -0,0 +1,392 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+*/
+
+/**
+  @brief Serves fuzzy lookups in one dictionary to any number of local clients over a Unix domain socket
+         The dictionary and the cache of compiled automata are loaded once and shared by all connections,
+         so a client pays neither the startup nor the memory of its own copy
+         Every connection has its own thread, which answers pipelined requests in order
+         and sends the answers of all requests that arrived together at once; see levprotocol.hpp
+         SIGINT or SIGTERM close all connections and end the server once their threads are done
+         Needs POSIX sockets
+*/
+
+#include <iostream>
+#include <set>
+#include <map>
+#include <vector>
+#include <tuple>
+#include <fstream>
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <cerrno>
+#include <csignal>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "levautomaton.hpp"
+#include "levprotocol.hpp"
+
+// The largest --max-k; the automaton of a long word grows fast with k, e.g. a subset construction
+// for 20 letters takes about 0.1 s with k = 5 and 2.5 s with k = 8
+#define MAX_SERVER_DISTANCE 5
+
+/// What all connections share
+struct Server
+{
+    CorpusPtr       dictionary;
+    DFACachePtr     cache;
+    unsigned        max_distance;   ///< requests with a larger k are refused
+    bool            log;            ///< whether every request is logged with its latency
+};
+
+/// The threads of the open connections, so that the server can end them and wait for them
+struct Connections
+{
+    std::mutex                  mutex;
+    std::condition_variable     closed;     ///< notified whenever a connection ends
+    std::map<int, std::thread>  running;    ///< by the socket they answer
+    std::vector<std::thread>    finished;   ///< ended, but not yet joined
+};
+
+static volatile std::sig_atomic_t stopping = 0;
+
+/**
+  @brief Ends the accept loop on SIGINT or SIGTERM
+*/
+void stop(int)
+{
+    stopping = 1;
+
+} // stop
+
+/**
+  @brief Loads a dictionary written by dictbuild, or reads, sorts and indexes a list of words,
+         in lowercase like dictbuild and the demos read it
+  @param path, the file
+  @return The dictionary, nullptr if the file cannot be read
+*/
+CorpusPtr load(const std::string& path)
+{
+    if (Corpus::is_index_file(path) == true) { return Corpus::load(path); }
+
+    std::ifstream filey(path);
+    if (!filey) { return nullptr; }
+
+    std::vector<std::string> words;
+    std::string line;
+    while(filey >> line) {
+        std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+        words.push_back(line);
+    }
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    return std::make_shared<Corpus>(words);
+
+} // load
+
+/**
+  @brief Answers one request
+         Repeated words of a request are looked up once
+  @param server, the shared dictionary and cache
+  @param request, a well-formed request
+  @return The response, without its latency
+*/
+LevProtocol::Response answer(const Server& server, const LevProtocol::Request& request)
+{
+    LevProtocol::Response response = {request.id, LevProtocol::OK, 0, {}};
+    if (request.op < LevProtocol::CHECK || request.op > LevProtocol::CLOSEST
+        || request.mode > LevenshteinAutomaton::LAZY_DFA || request.k > server.max_distance) {
+        response.status = LevProtocol::INVALID;
+        return response;
+    }
+
+    EditCosts costs = (request.flags & LevProtocol::DAMERAU) != 0 ? EditCosts::damerau() : EditCosts::levenshtein();
+    if ((request.flags & LevProtocol::UTF8) != 0) { costs = costs.over_utf8(); }
+    const LevenshteinAutomaton::Mode mode = static_cast<LevenshteinAutomaton::Mode>(request.mode);
+
+    std::map<std::string, std::size_t> seen;
+    for (auto& word: request.words) {
+        auto pos = seen.insert(std::make_pair(word, response.results.size()));
+        if (pos.second == false) {
+            std::vector<LevProtocol::Match> repeated = response.results[pos.first->second];
+            response.results.push_back(repeated);
+            continue;
+        }
+
+        std::vector<LevProtocol::Match> matches;
+        if (request.op == LevProtocol::CHECK) {
+            if (server.dictionary->contains(word) == true) {
+                LevProtocol::Match m = {word, 0};
+                matches.push_back(m);
+            }
+        }
+        else {
+            LevenshteinAutomaton lev(word, request.k, server.dictionary, mode, costs, server.cache);
+            if (request.op == LevProtocol::MATCH) {
+                lev.for_each_match([&](const std::string& found, unsigned distance) {
+                    LevProtocol::Match m = {found, distance};
+                    matches.push_back(m);
+                    return request.limit == 0 || matches.size() < request.limit;
+                });
+            }
+            else if (request.limit > 0) {
+                // The closest words come first among the best ones, and the search keeps no more than limit of them
+                LevenshteinAutomaton::MatchVec best = lev.get_top_matches(request.limit);
+                for (auto& found: best) {
+                    if (found.second != best[0].second) { break; }
+                    LevProtocol::Match m = {found.first, found.second};
+                    matches.push_back(m);
+                }
+            }
+            else {
+                unsigned distance = 0;
+                for (auto& found: lev.get_closest_matches(distance)) {
+                    LevProtocol::Match m = {found, distance};
+                    matches.push_back(m);
+                }
+            }
+        }
+        response.results.push_back(matches);
+    }
+
+    return response;
+
+} // answer
+
+/**
+  @brief Writes all of a buffer to a socket
+  @return false if the connection is lost
+*/
+bool write_all(const int& fd, const std::string& out)
+{
+    std::size_t done = 0;
+    while (done < out.size()) {
+        ssize_t n = write(fd, out.data() + done, out.size() - done);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        done += n;
+    }
+
+    return true;
+
+} // write_all
+
+/**
+  @brief Answers the requests of one connection until the client or the server closes it
+  @param server, the shared dictionary and cache
+  @param connections, where the thread is moved to the finished ones on return
+  @param fd, the connected socket, closed on return
+*/
+void serve(std::shared_ptr<const Server> server, Connections& connections, int fd)
+{
+    std::string in;
+    std::string out;
+    std::vector<char> chunk(1 << 16);
+    LevProtocol::Request request;
+    bool open = true;
+
+    while (open == true) {
+        ssize_t n = read(fd, chunk.data(), chunk.size());
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { break; }
+        in.append(chunk.data(), n);
+
+        // Answer every complete request that has arrived, in order
+        std::size_t used = 0;
+        while (true) {
+            const char* data = in.data() + used;
+            const std::size_t left = in.size() - used;
+            if (left >= LevProtocol::HEADER && LevProtocol::announced(data) > LevProtocol::MAX_FRAME) {
+                LevProtocol::Response refused = {0, LevProtocol::TOO_LARGE, 0, {}};
+                LevProtocol::encode(refused, out);
+                open = false;
+                break;
+            }
+
+            std::size_t size = LevProtocol::frame(data, left);
+            if (size == 0) { break; }
+
+            auto start = std::chrono::steady_clock::now();
+            LevProtocol::Response response = {0, LevProtocol::INVALID, 0, {}};
+            if (LevProtocol::decode(data, size, request) == true) { response = answer(*server, request); }
+            else { response.id = request.id; }
+            response.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now() - start).count();
+            LevProtocol::encode(response, out);
+            used += size;
+
+            if (server->log == true) {
+                std::ostringstream line;
+                line << "request " << response.id << ": " << request.words.size() << " words, status "
+                     << response.status << ", " << response.latency << " us\n";
+                std::cerr << line.str();
+            }
+        }
+        in.erase(0, used);
+
+        // The answers of pipelined requests go out together
+        if (out.empty() == false) {
+            if (write_all(fd, out) == false) { break; }
+            out.clear();
+        }
+    }
+
+    // The socket is closed under the lock, so the server never shuts down a reused descriptor
+    std::lock_guard<std::mutex> lock(connections.mutex);
+    close(fd);
+    connections.finished.push_back(std::move(connections.running[fd]));
+    connections.running.erase(fd);
+    connections.closed.notify_all();
+
+} // serve
+
+/**
+  @brief Joins the threads of the connections that have ended
+*/
+void join_finished(Connections& connections)
+{
+    std::vector<std::thread> finished;
+    {
+        std::lock_guard<std::mutex> lock(connections.mutex);
+        finished.swap(connections.finished);
+    }
+    for (auto& thread: finished) { thread.join(); }
+
+} // join_finished
+
+/**
+  @brief Prints the options
+*/
+void usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <dictionary> <socket> [options]\n"
+              << "  --max-k K          the largest k a request may ask for (3), at most " << MAX_SERVER_DISTANCE << "\n"
+              << "  --cache N          compiled automata kept for repeated lookups (" << DFA_CACHE_SIZE << ")\n"
+              << "  --log              log every request with its latency to standard error\n";
+
+} // usage
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        usage(argv[0]);
+        return -1;
+    }
+
+    std::shared_ptr<Server> server = std::make_shared<Server>();
+    server->max_distance = 3;
+    server->log = false;
+    std::size_t cache = DFA_CACHE_SIZE;
+
+    for (int i = 3; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--log") {
+            server->log = true;
+            continue;
+        }
+        if (i + 1 >= argc) { usage(argv[0]); return -1; }
+        std::string value = argv[++i];
+
+        if (option == "--max-k") {
+            unsigned long k = std::strtoul(value.c_str(), nullptr, 10);
+            if (k > MAX_SERVER_DISTANCE) { usage(argv[0]); return -1; }
+            server->max_distance = k;
+        }
+        else if (option == "--cache") { cache = std::strtoul(value.c_str(), nullptr, 10); }
+        else { usage(argv[0]); return -1; }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    server->dictionary = load(argv[1]);
+    if (server->dictionary == nullptr) {
+        std::cerr << "Could not load '" << argv[1] << "'\n";
+        return -2;
+    }
+    server->cache = std::make_shared<DFACache>(cache);
+    double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    const std::string path = argv[2];
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "The socket path '" << path << "' is too long\n";
+        return -3;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listener, 64) != 0) {
+        std::cerr << "Could not listen on '" << path << "': " << std::strerror(errno) << "\n";
+        return -3;
+    }
+
+    // A signal interrupts accept, a client that goes away must not end the server
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    // The connection threads block these signals, so they always reach the accept loop
+    sigset_t stop_signals, previous;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    Connections connections;
+
+    std::cerr << "Serving " << server->dictionary->size() << " words on '" << path << "', loaded in "
+              << load_ms << " ms\n";
+
+    while (stopping == 0) {
+        int fd = accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) { continue; }
+            std::cerr << "accept failed: " << std::strerror(errno) << "\n";
+            break;
+        }
+
+        pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+        {
+            std::lock_guard<std::mutex> lock(connections.mutex);
+            connections.running[fd] = std::thread(serve, std::shared_ptr<const Server>(server), std::ref(connections), fd);
+        }
+        pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        join_finished(connections);
+    }
+    close(listener);
+
+    // End the open connections and wait until no thread uses the dictionary anymore
+    {
+        std::unique_lock<std::mutex> lock(connections.mutex);
+        for (auto& connection: connections.running) { shutdown(connection.first, SHUT_RDWR); }
+        connections.closed.wait(lock, [&]() { return connections.running.empty(); });
+    }
+    join_finished(connections);
+    unlink(path.c_str());
+
+    return 0;
+}
@@ -0,0 +1,705 @@
+/*
+Lisanne Wiengarten
+Matrikelnr. 764870
+EAIDCL WiSe13/14
+gcc 4.9.1 C++11 Win10
+*/
+
+/**
+  @brief Compares the matches of every mode with a dynamic programming reference
+         on a generated corpus with and without an index, and loaded from a dictionary file,
+         for the Levenshtein, Damerau, weighted and UTF-8 costs, and those of a BatchMatcher
+         Costs of 0 have to give the same matches as costs of 1
+         A LazyDFA that drops states from its cache has to accept the same words as one that keeps them,
+         and the frames of lev_server have to decode to what was encoded
+         Also checks that a dictionary file survives writing and loading and that a truncated one is refused
+         Prints every mismatch and returns 1 if there was one; run by ctest
+*/
+
+#include <iostream>
+#include <set>
+#include <map>
+#include <vector>
+#include <tuple>
+#include <fstream>
+#include <algorithm>
+#include <deque>
+#include <sstream>
+#include <string>
+#include <iterator>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "levautomaton.hpp"
+#include "batchmatcher.hpp"
+#include "levprotocol.hpp"
+
+
+typedef std::vector<std::string>            WordVec;
+typedef LevenshteinAutomaton::MatchVec      MatchVec;
+
+static unsigned failures = 0;
+
+
+/**
+  @brief Decodes a well-formed UTF-8 word without the help of Utf8, so that the reference does not share its mistakes
+  @param word, the bytes
+  @param codepoints, receives the codepoints
+  @return false if the word is not well-formed
+*/
+bool decode_utf8(const std::string& word, std::vector<std::uint32_t>& codepoints)
+{
+    codepoints.clear();
+    for (std::size_t i = 0; i < word.size(); ) {
+        const unsigned char lead = word[i];
+        std::size_t n = 0;
+        if (lead < 0x80) { n = 1; }
+        else if (lead >= 0xC2 && lead < 0xE0) { n = 2; }
+        else if (lead >= 0xE0 && lead < 0xF0) { n = 3; }
+        else if (lead >= 0xF0 && lead < 0xF5) { n = 4; }
+        if (n == 0 || i + n > word.size()) { return false; }
+
+        std::uint32_t c = n == 1 ? lead : lead & (0x7F >> n);
+        for (std::size_t j = 1; j < n; j++) {
+            const unsigned char next = word[i + j];
+            if ((next & 0xC0) != 0x80) { return false; }
+            c = (c << 6) | (next & 0x3F);
+        }
+
+        // Overlong forms, surrogates and values above U+10FFFF
+        if ((n == 3 && c < 0x800) || (n == 4 && c < 0x10000) || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+            return false;
+        }
+        codepoints.push_back(c);
+        i += n;
+    }
+
+    return true;
+
+} // decode_utf8
+
+/**
+  @brief Splits a word into its symbols, bytes or codepoints
+         A lookup word that is no UTF-8 has a replacement codepoint for every byte outside a sequence, like Utf8::decode
+*/
+std::vector<std::uint32_t> symbols(const std::string& word, const EditCosts& costs)
+{
+    std::vector<std::uint32_t> codepoints;
+    if (costs.utf8 == true) {
+        if (decode_utf8(word, codepoints) == false) { codepoints = Utf8::decode(word); }
+        return codepoints;
+    }
+
+    for (auto c: word) { codepoints.push_back(static_cast<unsigned char>(c)); }
+    return codepoints;
+
+} // symbols
+
+/**
+  @brief Computes the restricted Damerau-Levenshtein distance with the given costs by dynamic programming
+  @param lookup, the symbols of the lookup word
+  @param input, the symbols of a corpus word
+  @param costs, the cost of every edit operation
+  @return The cheapest way to turn the lookup word into the input
+*/
+unsigned reference_distance(const std::vector<std::uint32_t>& lookup, const std::vector<std::uint32_t>& input,
+                            const EditCosts& costs)
+{
+    std::vector<std::vector<unsigned>> d(lookup.size() + 1, std::vector<unsigned>(input.size() + 1, 0));
+    for (std::size_t i = 0; i <= lookup.size(); i++) { d[i][0] = i * costs.insertion; }
+    for (std::size_t j = 0; j <= input.size(); j++) { d[0][j] = j * costs.deletion; }
+
+    for (std::size_t i = 1; i <= lookup.size(); i++) {
+        for (std::size_t j = 1; j <= input.size(); j++) {
+            unsigned substitution = d[i-1][j-1] + (lookup[i-1] != input[j-1] ? costs.substitution : 0);
+            d[i][j] = std::min(std::min(d[i-1][j] + costs.insertion, d[i][j-1] + costs.deletion), substitution);
+
+            if (costs.transposition > 0 && i > 1 && j > 1 && lookup[i-1] != lookup[i-2]
+                && lookup[i-1] == input[j-2] && lookup[i-2] == input[j-1]) {
+                d[i][j] = std::min(d[i][j], d[i-2][j-2] + costs.transposition);
+            }
+        }
+    }
+
+    return d[lookup.size()][input.size()];
+
+} // reference_distance
+
+/**
+  @brief Returns all words within distance k by comparing the lookup word with every one of them
+         Over UTF-8 only well-formed words can match, like in the automaton
+  @return (word, distance) pairs sorted by word
+*/
+MatchVec reference_matches(const std::string& lookup, const unsigned& k, const WordVec& words, const EditCosts& costs)
+{
+    MatchVec matches;
+    const std::vector<std::uint32_t> lookup_symbols = symbols(lookup, costs);
+    std::vector<std::uint32_t> codepoints;
+    for (auto& word: words) {
+        if (costs.utf8 == true && decode_utf8(word, codepoints) == false) { continue; }
+
+        const std::vector<std::uint32_t> word_symbols = symbols(word, costs);
+        unsigned distance = reference_distance(lookup_symbols, word_symbols, costs);
+        if (distance <= k) { matches.push_back(std::make_pair(word, distance)); }
+    }
+
+    return matches;
+
+} // reference_matches
+
+/**
+  @brief Returns the words that begin with a prefix within distance k, by comparing the lookup word with every prefix
+         Over UTF-8 only the prefixes that are well-formed are compared, the rest of the word may be anything
+  @param limit, the largest number of words wanted
+  @return The first limit such words, sorted
+*/
+WordVec reference_prefix_matches(const std::string& lookup, const unsigned& k, const WordVec& words,
+                                 const EditCosts& costs, const std::size_t& limit)
+{
+    WordVec matches;
+    const std::vector<std::uint32_t> lookup_symbols = symbols(lookup, costs);
+    std::vector<std::uint32_t> codepoints;
+    for (auto& word: words) {
+        for (std::size_t i = 0; i <= word.size() && matches.size() < limit; i++) {
+            const std::string prefix = word.substr(0, i);
+            if (costs.utf8 == true && decode_utf8(prefix, codepoints) == false) { continue; }
+
+            if (reference_distance(lookup_symbols, symbols(prefix, costs), costs) <= k) {
+                matches.push_back(word);
+                break;
+            }
+        }
+    }
+
+    return matches;
+
+} // reference_prefix_matches
+
+/**
+  @brief Reports a mismatch, the first ones in detail
+*/
+void fail(const std::string& what, const std::string& lookup, const unsigned& k, const std::string& setup)
+{
+    if (failures < 20) {
+        std::cerr << "MISMATCH in " << what << " for '" << lookup << "', k = " << k << ", " << setup << "\n";
+    }
+    failures++;
+
+} // fail
+
+/**
+  @brief Generates a corpus over a few ASCII letters and some multibyte codepoints,
+         with the empty word and one byte that is no UTF-8
+*/
+WordVec generate_corpus(std::mt19937& rng, const std::size_t& count)
+{
+    const char* const symbols[] = {"a", "b", "c", "d", "e", "\xC3\xA4", "\xC3\x9F", "\xE6\x97\xA5", "\xF0\x9F\x98\x80"};
+    const std::size_t alphabet = sizeof(symbols) / sizeof(symbols[0]);
+
+    WordVec words(1, "");
+    words.push_back("ab\xFF");
+    while (words.size() < count) {
+        std::string word;
+        std::size_t length = 1 + rng() % 7;
+        for (std::size_t i = 0; i < length; i++) {
+            // Mostly ASCII, so that the words share enough to match
+            word += rng() % 4 == 0 ? symbols[5 + rng() % (alphabet - 5)] : symbols[rng() % 5];
+        }
+        words.push_back(word);
+    }
+
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+
+} // generate_corpus
+
+/**
+  @brief Returns lookup words: corpus words with a few bytes changed, swapped, inserted or removed, and the empty word
+*/
+WordVec generate_queries(std::mt19937& rng, const WordVec& words, const std::size_t& count)
+{
+    WordVec queries(1, "");
+    while (queries.size() < count) {
+        std::string query = words[rng() % words.size()];
+        if (query.size() > 1 && rng() % 2 == 0) {
+            std::size_t pos = rng() % (query.size() - 1);
+            std::swap(query[pos], query[pos + 1]);
+        }
+        if (rng() % 3 == 0) { query.insert(query.begin() + rng() % (query.size() + 1), 'a' + rng() % 5); }
+        if (query.size() > 0 && rng() % 3 == 0) { query.erase(rng() % query.size(), 1); }
+        queries.push_back(query);
+    }
+
+    return queries;
+
+} // generate_queries
+
+/**
+  @brief Checks all queries of one corpus in every mode against the reference
+  @param dictionary, the corpus to search
+  @param words, its words
+  @param setup, describes the corpus in messages
+  @param cache, shared by all automata if given
+  @param pool, used to split the walks through an index
+  @return The number of lookups checked
+*/
+std::size_t check_corpus(const CorpusPtr& dictionary, const WordVec& words, const WordVec& queries,
+                         const std::string& setup, const DFACachePtr& cache, WorkStealingPool& pool)
+{
+    const char* const modes[] = {"subset", "parametric", "bitparallel", "columnar", "lazy"};
+    EditCosts weighted = {1, 2, 1, 0, false};
+    EditCosts swaps = {2, 1, 2, 1, false};
+    const EditCosts costs[] = {EditCosts::levenshtein(), EditCosts::damerau(), weighted, swaps,
+                               EditCosts::levenshtein().over_utf8(), EditCosts::damerau().over_utf8()};
+    const char* const cost_names[] = {"levenshtein", "damerau", "weighted", "weighted damerau",
+                                      "levenshtein utf8", "damerau utf8"};
+
+    std::size_t checked = 0;
+    for (std::size_t c = 0; c < sizeof(costs) / sizeof(costs[0]); c++) {
+        for (unsigned k = 0; k <= 3; k++) {
+            for (auto& query: queries) {
+                const MatchVec expected = reference_matches(query, k, words, costs[c]);
+
+                WordVec expected_words;
+                for (auto& m: expected) { expected_words.push_back(m.first); }
+
+                MatchVec ranked = expected;
+                std::stable_sort(ranked.begin(), ranked.end(),
+                                 [](const LevenshteinAutomaton::Match& a, const LevenshteinAutomaton::Match& b) {
+                                     return a.second < b.second;
+                                 });
+                unsigned closest_distance = ranked.empty() == true ? k + 1 : ranked[0].second;
+                WordVec closest;
+                for (auto& m: ranked) {
+                    if (m.second == closest_distance) { closest.push_back(m.first); }
+                }
+                if (ranked.size() > 5) { ranked.resize(5); }
+
+                std::vector<WordVec> by_distance(k + 1);
+                for (auto& m: expected) { by_distance[m.second].push_back(m.first); }
+
+                const WordVec completions = reference_prefix_matches(query, k, words, costs[c], words.size());
+                WordVec first_completions = completions;
+                if (first_completions.size() > 4) { first_completions.resize(4); }
+
+                WordVec first_words = expected_words;
+                if (first_words.size() > 3) { first_words.resize(3); }
+
+                for (unsigned m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+                    const std::string where = setup + ", " + modes[m] + ", " + cost_names[c];
+                    const LevenshteinAutomaton::Mode mode = static_cast<LevenshteinAutomaton::Mode>(m);
+
+                    LevenshteinAutomaton lev(query, k, dictionary, mode, costs[c], cache);
+                    if (lev.get_scored_matches() != expected) { fail("get_scored_matches", query, k, where); }
+                    if (lev.get_all_matches(pool) != expected_words) { fail("get_all_matches(pool)", query, k, where); }
+                    if (lev.get_top_matches(5) != ranked) { fail("get_top_matches", query, k, where); }
+                    if (lev.get_matches_by_distance() != by_distance) { fail("get_matches_by_distance", query, k, where); }
+                    if (lev.get_prefix_matches(words.size()) != completions) { fail("get_prefix_matches", query, k, where); }
+                    if (lev.get_prefix_matches(4) != first_completions) { fail("get_prefix_matches(4)", query, k, where); }
+                    if (lev.get_first_matches(3) != first_words) { fail("get_first_matches", query, k, where); }
+
+                    // Everything as it is found, then only the first word
+                    MatchVec streamed;
+                    std::size_t visited = lev.for_each_match([&streamed](const std::string& word, const unsigned& d) {
+                        streamed.push_back(std::make_pair(word, d));
+                        return true;
+                    });
+                    if (streamed != expected || visited != expected.size()) { fail("for_each_match", query, k, where); }
+
+                    visited = lev.for_each_match([](const std::string&, const unsigned&) { return false; });
+                    if (visited != std::min<std::size_t>(expected.size(), 1)) { fail("for_each_match, stop", query, k, where); }
+
+                    unsigned distance = 0;
+                    if (lev.get_closest_matches(distance) != closest || distance != closest_distance) {
+                        fail("get_closest_matches", query, k, where);
+                    }
+                    checked++;
+                }
+            } // for queries
+        } // for k
+    } // for costs
+
+    return checked;
+
+} // check_corpus
+
+/**
+  @brief Lists every word a LazyDFA accepts, in lexicographic order
+*/
+WordVec lazy_words(const LazyDFA& lazy)
+{
+    WordVec accepted;
+    std::string input;
+    std::string result;
+    std::vector<LazyDFA::State> stack;
+    while (lazy.next_valid(input, result, stack) == true) {
+        accepted.push_back(result);
+        input = result + '\0';
+    }
+
+    return accepted;
+
+} // lazy_words
+
+/**
+  @brief Checks that a LazyDFA with room for two states accepts the same words as one that keeps all of them,
+         and that states held across an assignment stay usable
+  @return The number of lookups checked
+*/
+std::size_t check_lazy_dfa()
+{
+    // "abcd" with at most one byte replaced
+    const std::string word = "abcd";
+    std::shared_ptr<NFAutomaton> nfa = std::make_shared<NFAutomaton>();
+    for (int i = 0; i < 4; i++) {
+        nfa->add_transition(std::make_tuple(i, 0), Label::byte(word[i]), std::make_tuple(i + 1, 0));
+        nfa->add_transition(std::make_tuple(i, 1), Label::byte(word[i]), std::make_tuple(i + 1, 1));
+        nfa->add_transition(std::make_tuple(i, 0), Label::any(), std::make_tuple(i + 1, 1));
+    }
+    nfa->add_final_state(std::make_tuple(4, 0));
+    nfa->add_final_state(std::make_tuple(4, 1));
+
+    LazyDFA small(nfa, 2);
+    const WordVec expected = lazy_words(LazyDFA(nfa, 4096));
+    if (expected.size() != 1 + 4 * 255 || lazy_words(small) != expected || small.size() > 2) {
+        fail("LazyDFA with 2 states", word, 1, "hand-built NFA");
+    }
+
+    // Both states are cached when the automaton is replaced, a is asked for its known transition to ab afterwards
+    LazyDFA::State a = small.next_state(small.start(), 'a');
+    LazyDFA::State ab = small.next_state(a, 'b');
+    small = LazyDFA(nfa, 2);
+    LazyDFA::State abc = small.next_state(small.next_state(a, 'b'), 'c');
+    if (small.next_state(a, 'b') != ab || small.is_final(small.next_state(abc, 'd')) == false) {
+        fail("LazyDFA::operator=", word, 1, "hand-built NFA");
+    }
+
+    return expected.size() + 1;
+
+} // check_lazy_dfa
+
+/**
+  @brief Checks that a DFACache with room for two automata shares them between the lookups of the same key,
+         drops the least recently used one and tells lookups with other costs apart
+  @return The number of lookups checked
+*/
+std::size_t check_dfa_cache(const CorpusPtr& dictionary)
+{
+    DFACachePtr cache = std::make_shared<DFACache>(2);
+    auto compiled = [&](const std::string& word, const EditCosts& costs) {
+        LevenshteinAutomaton lev(word, 1, dictionary, LevenshteinAutomaton::SUBSET_CONSTRUCTION, costs, cache);
+        return &lev.get_compiled_dfa();
+    };
+
+    // The first automaton is held, so that no later one can take its address once it is dropped
+    const EditCosts levenshtein = EditCosts::levenshtein();
+    LevenshteinAutomaton held("abc", 1, dictionary, LevenshteinAutomaton::SUBSET_CONSTRUCTION, levenshtein, cache);
+    const CompiledDFA* first = &held.get_compiled_dfa();
+    bool same = compiled("abc", levenshtein) == first;
+    compiled("bcd", levenshtein);
+    same = same && compiled("abc", levenshtein) == first;
+    compiled("cde", levenshtein);
+    compiled("bcd", levenshtein);
+    same = same && compiled("abc", EditCosts::damerau()) != first;
+
+    // Hits: abc twice; misses: abc, bcd, cde, bcd again, abc damerau; evicted: bcd, abc, cde
+    const DFACache::Statistics counted = cache->statistics();
+    if (same == false || counted.hits != 2 || counted.misses != 5 || counted.evictions != 3 || counted.size != 2) {
+        fail("DFACache", "abc", 1, "cache of 2");
+    }
+
+    return 7;
+
+} // check_dfa_cache
+
+/**
+  @brief Checks that the statistics of a lookup count the matches it handed out, in every mode,
+         and that they stay 0 unless LEV_ENABLE_STATS is set
+  @return The number of lookups checked
+*/
+std::size_t check_statistics(const CorpusPtr& dictionary, const WordVec& queries)
+{
+    std::size_t checked = 0;
+    for (auto& query: queries) {
+        for (unsigned m = 0; m <= LevenshteinAutomaton::LAZY_DFA; m++) {
+            LevenshteinAutomaton lev(query, 2, dictionary, static_cast<LevenshteinAutomaton::Mode>(m));
+            const std::size_t found = lev.get_all_matches().size();
+            const QueryStats& stats = lev.statistics();
+
+            bool counted = stats.counters.matches == found;
+            if (LEV_ENABLE_STATS == 0) { counted = stats.counters.matches == 0 && stats.traverse_us == 0; }
+            if (counted == false) { fail("statistics", query, 2, "mode " + std::to_string(m)); }
+            checked++;
+        }
+    }
+
+    return checked;
+
+} // check_statistics
+
+/**
+  @brief Checks the automata that copy a list of words instead of sharing a Corpus, in every mode
+         COLUMNAR_SCAN falls back there, since the copy has no ColumnarCorpus
+  @return The number of lookups checked
+*/
+std::size_t check_copied_corpus(const WordVec& words, const WordVec& queries)
+{
+    std::size_t checked = 0;
+    for (unsigned k = 0; k <= 3; k++) {
+        for (auto& query: queries) {
+            WordVec expected;
+            for (auto& m: reference_matches(query, k, words, EditCosts::levenshtein())) { expected.push_back(m.first); }
+
+            for (unsigned m = 0; m <= LevenshteinAutomaton::LAZY_DFA; m++) {
+                const std::string where = "copied corpus, mode " + std::to_string(m);
+                LevenshteinAutomaton lev(query, k, words, static_cast<LevenshteinAutomaton::Mode>(m));
+                if (lev.get_all_matches() != expected) { fail("get_all_matches", query, k, where); }
+                checked++;
+            }
+        }
+    }
+
+    return checked;
+
+} // check_copied_corpus
+
+/**
+  @brief Checks that costs of 0 count as 1 in every mode instead of letting the search run forever
+  @return The number of lookups checked
+*/
+std::size_t check_zero_costs(const CorpusPtr& dictionary, const WordVec& words, const WordVec& queries,
+                             const std::string& setup)
+{
+    EditCosts free_deletion = {1, 0, 1, 0, false};
+    EditCosts all_free = {0, 0, 0, 1, false};
+    const EditCosts costs[] = {free_deletion, all_free, all_free.over_utf8()};
+
+    std::size_t checked = 0;
+    for (std::size_t c = 0; c < sizeof(costs) / sizeof(costs[0]); c++) {
+        for (unsigned k = 0; k <= 2; k++) {
+            for (auto& query: queries) {
+                const MatchVec expected = reference_matches(query, k, words, costs[c].clamped());
+
+                for (unsigned m = 0; m <= LevenshteinAutomaton::LAZY_DFA; m++) {
+                    const std::string where = setup + ", zero costs " + std::to_string(c) + ", mode " + std::to_string(m);
+                    LevenshteinAutomaton lev(query, k, dictionary, static_cast<LevenshteinAutomaton::Mode>(m), costs[c]);
+                    if (lev.get_scored_matches() != expected) { fail("get_scored_matches", query, k, where); }
+                    checked++;
+                }
+            }
+        }
+    } // for costs
+
+    return checked;
+
+} // check_zero_costs
+
+/**
+  @brief Checks that a BatchMatcher finds the same words as the reference for every query,
+         also for repeated queries, on its own and on a pool that two threads use at once
+  @param pool, shared by the BatchMatchers
+  @return The number of lookups checked
+*/
+std::size_t check_batch(const CorpusPtr& dictionary, const WordVec& words, const WordVec& queries,
+                        const std::string& setup, WorkStealingPool& pool)
+{
+    WordVec batch = queries;
+    batch.insert(batch.end(), queries.rbegin(), queries.rend());
+
+    std::size_t checked = 0;
+    for (unsigned k = 0; k <= 3; k++) {
+        std::vector<WordVec> expected;
+        for (auto& query: batch) {
+            expected.push_back(WordVec());
+            for (auto& m: reference_matches(query, k, words, EditCosts::levenshtein())) {
+                expected.back().push_back(m.first);
+            }
+        }
+
+        for (unsigned m = 0; m <= LevenshteinAutomaton::LAZY_DFA; m++) {
+            const std::string where = setup + ", batch mode " + std::to_string(m);
+            BatchMatcher matcher(dictionary, k, static_cast<LevenshteinAutomaton::Mode>(m));
+
+            const std::vector<WordVec> found = matcher.match(batch);
+            for (std::size_t q = 0; q < batch.size(); q++) {
+                if (q >= found.size() || found[q] != expected[q]) { fail("BatchMatcher::match", batch[q], k, where); }
+            }
+            checked += batch.size();
+
+            // Fewer queries than threads split the walks of each query instead
+            const WordVec few(batch.begin(), batch.begin() + 2);
+            std::vector<WordVec> few_found;
+            std::vector<WordVec> pool_found;
+            std::thread other([&]() { few_found = matcher.match(few, pool); });
+            pool_found = matcher.match(batch, pool);
+            other.join();
+
+            for (std::size_t q = 0; q < batch.size(); q++) {
+                if (q >= pool_found.size() || pool_found[q] != expected[q]) {
+                    fail("BatchMatcher::match(pool)", batch[q], k, where);
+                }
+            }
+            for (std::size_t q = 0; q < few.size(); q++) {
+                if (q >= few_found.size() || few_found[q] != expected[q]) {
+                    fail("BatchMatcher::match(pool)", few[q], k, where);
+                }
+            }
+            checked += batch.size() + few.size();
+        }
+    } // for k
+
+    return checked;
+
+} // check_batch
+
+/**
+  @brief Checks that requests and responses of lev_server come out of a buffer as they went in,
+         two frames after each other, and that an incomplete frame is neither taken nor decoded
+  @param words, the results of the response are their reference matches
+  @return The number of frames checked
+*/
+std::size_t check_protocol(const WordVec& words, const WordVec& queries)
+{
+    LevProtocol::Request request = {7, LevProtocol::CLOSEST, 2, LevProtocol::DAMERAU | LevProtocol::UTF8,
+                                    LevenshteinAutomaton::LAZY_DFA, 5, queries};
+    request.words.push_back(std::string("a\0b", 3));
+    LevProtocol::Response response = {7, LevProtocol::OK, 1234, std::vector<std::vector<LevProtocol::Match>>()};
+    for (auto& query: request.words) {
+        response.results.push_back(std::vector<LevProtocol::Match>());
+        for (auto& m: reference_matches(query, 1, words, EditCosts::levenshtein())) {
+            LevProtocol::Match match = {m.first, m.second};
+            response.results.back().push_back(match);
+        }
+    }
+
+    std::string buffer;
+    LevProtocol::encode(request, buffer);
+    const std::size_t request_size = buffer.size();
+    LevProtocol::encode(response, buffer);
+
+    LevProtocol::Request r;
+    LevProtocol::Response s;
+    bool same = LevProtocol::frame(buffer.data(), request_size - 1) == 0
+                && LevProtocol::frame(buffer.data(), buffer.size()) == request_size
+                && LevProtocol::decode(buffer.data(), request_size - 1, r) == false
+                && LevProtocol::decode(buffer.data(), request_size, r) == true
+                && r.id == request.id && r.op == request.op && r.k == request.k && r.flags == request.flags
+                && r.mode == request.mode && r.limit == request.limit && r.words == request.words;
+
+    const char* second = buffer.data() + request_size;
+    const std::size_t response_size = LevProtocol::frame(second, buffer.size() - request_size);
+    same = same && response_size == buffer.size() - request_size
+           && LevProtocol::decode(second, response_size, s) == true
+           && s.id == response.id && s.status == response.status && s.latency == response.latency
+           && s.results.size() == response.results.size();
+    for (std::size_t q = 0; same == true && q < s.results.size(); q++) {
+        same = s.results[q].size() == response.results[q].size();
+        for (std::size_t i = 0; same == true && i < s.results[q].size(); i++) {
+            same = s.results[q][i].word == response.results[q][i].word
+                   && s.results[q][i].distance == response.results[q][i].distance;
+        }
+    }
+    if (same == false) { fail("LevProtocol round trip", "", 1, "encoded and decoded"); }
+
+    return 2;
+
+} // check_protocol
+
+/**
+  @brief Writes a corpus like dictbuild does, loads it back and checks that it still holds the same words
+         and finds the same next word for every probe as the sorted list
+  @param path, where the file is written
+  @return The loaded corpus, nullptr if it could not be written or loaded
+*/
+CorpusPtr round_trip(const Corpus& corpus, const WordVec& words, const WordVec& probes, const std::string& path)
+{
+    if (corpus.save(path) == false) {
+        std::cerr << "Could not write '" << path << "'\n";
+        failures++;
+        return nullptr;
+    }
+
+    CorpusPtr loaded = Corpus::load(path);
+    if (loaded == nullptr || loaded->size() != words.size()) {
+        std::cerr << "Could not load '" << path << "' again\n";
+        failures++;
+        return nullptr;
+    }
+
+    for (auto& word: words) {
+        if (loaded->contains(word) == false) { fail("contains after loading", word, 0, path); }
+    }
+    if (loaded->contains("not in the corpus") == true) { fail("contains after loading", "not in the corpus", 0, path); }
+
+    for (auto& probe: probes) {
+        auto pos = std::lower_bound(words.begin(), words.end(), probe);
+        std::string next;
+        bool found = loaded->next_in_corpus(probe, next);
+        if (found != (pos != words.end()) || (found == true && next != *pos)) { fail("next_in_corpus", probe, 0, path); }
+    }
+
+    // A truncated file is refused instead of read beyond its end
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const std::string truncated_path = path + ".truncated";
+    std::ofstream out(truncated_path.c_str(), std::ios::binary);
+    out.write(bytes.data(), bytes.size() / 2);
+    out.close();
+    if (Corpus::load(truncated_path) != nullptr) {
+        std::cerr << "The truncated file '" << truncated_path << "' was loaded\n";
+        failures++;
+    }
+
+    // So is a file whose header announces a different number of words than its paths spell
+    CorpusIndex::FileHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    header.words++;
+    const std::string miscounted_path = path + ".miscounted";
+    out.open(miscounted_path.c_str(), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(bytes.data() + sizeof(header), bytes.size() - sizeof(header));
+    out.close();
+    if (Corpus::load(miscounted_path) != nullptr) {
+        std::cerr << "The miscounted file '" << miscounted_path << "' was loaded\n";
+        failures++;
+    }
+
+    return loaded;
+
+} // round_trip
+
+
+int main(int, char* argv[])
+{
+    std::mt19937 rng(764870);
+    const WordVec words = generate_corpus(rng, 600);
+    const WordVec queries = generate_queries(rng, words, 24);
+    WorkStealingPool pool(4);
+
+    CorpusPtr indexed = std::make_shared<Corpus>(words, true, true);
+    CorpusPtr plain = std::make_shared<Corpus>(words, false, true);
+    WordVec probes = generate_queries(rng, words, 2000);
+    for (auto& word: words) { probes.push_back(word + '\0'); }
+    CorpusPtr loaded = round_trip(*indexed, words, probes, std::string(argv[0]) + ".idx");
+
+    std::size_t checked = 0;
+    checked += check_corpus(indexed, words, queries, "with index", nullptr, pool);
+    checked += check_corpus(plain, words, queries, "without index", nullptr, pool);
+    if (loaded != nullptr) {
+        checked += check_corpus(loaded, words, queries, "loaded, cached", std::make_shared<DFACache>(64), pool);
+    }
+    checked += check_copied_corpus(words, queries);
+    checked += check_lazy_dfa();
+    checked += check_dfa_cache(indexed);
+    checked += check_statistics(indexed, queries);
+    checked += check_protocol(words, queries);
+    checked += check_batch(indexed, words, queries, "with index", pool);
+    checked += check_zero_costs(indexed, words, queries, "with index");
+
+    std::cout << checked << " lookups in " << words.size() << " words checked, " << failures << " mismatches\n";
+
+    return failures == 0 ? 0 : 1;
+}